@@ -0,0 +1,942 @@
+#include "animexport.h"
+#include "ditherkernel.h"
+#include "videodecoder.h"
+#include "platform.h"
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/opt.h>
+#include <pthread.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Frames are decoded and diffed one at a time, then encoded a batch at a time across threads.
+#define EXPORT_BATCH_SIZE 32
+#define EXPORT_MAX_THREADS 16
+// Browsers slow GIF frames shorter than 20ms down to 100ms, so anything faster than 50fps gets thinned out.
+#define GIF_MIN_DELAY_MS 20
+
+// Every format stores frames as these palette indices
+#define INDEX_DARK 0
+#define INDEX_LIGHT 1
+#define INDEX_UNCHANGED 2
+
+#define LZW_MAX_CODE 4095
+#define LZW_HASH_BITS 13
+#define LZW_HASH_SIZE (1 << LZW_HASH_BITS)
+
+#define DEFLATE_WINDOW 32768
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+#define DEFLATE_HASH_BITS 15
+#define DEFLATE_HASH_SIZE (1 << DEFLATE_HASH_BITS)
+
+typedef struct {
+    // Region that changed since the last kept frame
+    int x;
+    int y;
+    int width;
+    int height;
+    int startMs;
+    unsigned char* indices;  // width*height INDEX_* values
+
+    // Encoded image data, whatever the format puts between its frame headers
+    unsigned char* data;
+    size_t size;
+    size_t capacity;
+    bool encoded;
+} ExportFrame;
+
+typedef struct {
+    ExportFormat format;
+    FILE* file;
+    int width;
+    int height;
+    Color lightColor;
+    Color darkColor;
+
+    // APNG
+    unsigned int sequence;
+    unsigned int frameCount;
+    long actlOffset;
+
+    // WebP goes through FFmpeg
+    AVFormatContext* muxer;
+    AVCodecContext* encoder;
+    AVFrame* frame;
+    AVPacket* packet;
+    unsigned char* canvas;
+} AnimationWriter;
+
+typedef struct {
+    ExportFrame* frames;
+    int count;
+    int next;
+    int width;
+    int height;
+    ExportFormat format;
+    bool background;
+    pthread_mutex_t lock;
+} EncodeBatch;
+
+
+bool GetExportFormat(const char* fileName, ExportFormat* format) {
+    if (IsFileExtension(fileName, ".gif")) *format = EXPORT_FORMAT_GIF;
+    else if (IsFileExtension(fileName, ".png") || IsFileExtension(fileName, ".apng")) *format = EXPORT_FORMAT_APNG;
+    else if (IsFileExtension(fileName, ".webp")) *format = EXPORT_FORMAT_WEBP;
+    else return false;
+    return true;
+}
+
+
+static void AppendBytes(ExportFrame* frame, const void* bytes, size_t count) {
+    if (frame->size + count > frame->capacity) {
+        size_t capacity = (frame->capacity > 0) ? frame->capacity : 4096;
+        while (capacity < frame->size + count) capacity *= 2;
+        frame->data = (unsigned char*)realloc(frame->data, capacity);
+        frame->capacity = capacity;
+    }
+    memcpy(frame->data + frame->size, bytes, count);
+    frame->size += count;
+}
+
+
+//----------------------------------------------------------------------------------
+// GIF
+//----------------------------------------------------------------------------------
+
+// Dictionary for one LZW run. Keys are (prefix code << 8 | index) + 1 so that 0 can mean empty.
+typedef struct {
+    int keys[LZW_HASH_SIZE];
+    short codes[LZW_HASH_SIZE];
+} LzwTable;
+
+// Packs codes LSB first into the 255 byte sub-blocks GIF wants.
+typedef struct {
+    ExportFrame* frame;
+    unsigned int bits;
+    int bitCount;
+    unsigned char block[255];
+    int blockSize;
+} GifBitWriter;
+
+
+static void FlushGifBlock(GifBitWriter* writer) {
+    if (writer->blockSize == 0) return;
+    unsigned char size = (unsigned char)writer->blockSize;
+    AppendBytes(writer->frame, &size, 1);
+    AppendBytes(writer->frame, writer->block, writer->blockSize);
+    writer->blockSize = 0;
+}
+
+
+static void WriteGifCode(GifBitWriter* writer, int code, int codeSize) {
+    writer->bits |= (unsigned int)code << writer->bitCount;
+    writer->bitCount += codeSize;
+    while (writer->bitCount >= 8) {
+        writer->block[writer->blockSize++] = (unsigned char)(writer->bits & 0xff);
+        if (writer->blockSize == 255) FlushGifBlock(writer);
+        writer->bits >>= 8;
+        writer->bitCount -= 8;
+    }
+}
+
+
+// Returns the code for key, or -1 with *slot set to where it would go.
+static int FindLzwCode(const LzwTable* table, int key, int* slot) {
+    unsigned int index = ((unsigned int)key * 2654435761u) >> (32 - LZW_HASH_BITS);
+    while (table->keys[index] != 0) {
+        if (table->keys[index] == key) return table->codes[index];
+        index = (index + 1) & (LZW_HASH_SIZE - 1);
+    }
+    *slot = (int)index;
+    return -1;
+}
+
+
+static void EncodeGifFrame(ExportFrame* frame, LzwTable* table) {
+    // Three colors still fit the smallest code size GIF allows
+    const int minCodeSize = 2;
+    const int clearCode = 1 << minCodeSize;
+    const int endCode = clearCode + 1;
+
+    unsigned char minCodeSizeByte = minCodeSize;
+    frame->size = 0;
+    AppendBytes(frame, &minCodeSizeByte, 1);
+
+    GifBitWriter writer = {frame};
+    int codeSize = minCodeSize + 1;
+    int maxCode = endCode;
+    memset(table->keys, 0, sizeof(table->keys));
+    WriteGifCode(&writer, clearCode, codeSize);
+
+    int count = frame->width * frame->height;
+    int current = frame->indices[0];
+    for (int i = 1; i < count; i++) {
+        int next = frame->indices[i];
+        int key = ((current << 8) | next) + 1;
+        int slot = 0;
+        int code = FindLzwCode(table, key, &slot);
+        if (code >= 0) {
+            current = code;
+            continue;
+        }
+
+        WriteGifCode(&writer, current, codeSize);
+        table->keys[slot] = key;
+        table->codes[slot] = (short)++maxCode;
+        if (maxCode >= (1 << codeSize)) codeSize++;
+
+        // Dictionary is full, start over
+        if (maxCode == LZW_MAX_CODE) {
+            WriteGifCode(&writer, clearCode, codeSize);
+            memset(table->keys, 0, sizeof(table->keys));
+            codeSize = minCodeSize + 1;
+            maxCode = endCode;
+        }
+        current = next;
+    }
+
+    WriteGifCode(&writer, current, codeSize);
+    WriteGifCode(&writer, endCode, codeSize);
+    if (writer.bitCount > 0) WriteGifCode(&writer, 0, 8 - writer.bitCount);
+    FlushGifBlock(&writer);
+
+    unsigned char terminator = 0;
+    AppendBytes(frame, &terminator, 1);
+}
+
+
+static void PutShortLE(FILE* file, int value) {
+    fputc(value & 0xff, file);
+    fputc((value >> 8) & 0xff, file);
+}
+
+
+static bool BeginGif(AnimationWriter* writer) {
+    FILE* file = writer->file;
+    fwrite("GIF89a", 1, 6, file);
+    PutShortLE(file, writer->width);
+    PutShortLE(file, writer->height);
+    fputc(0x91, file);  // Global color table, 4 entries
+    fputc(INDEX_DARK, file);
+    fputc(0, file);
+
+    // Dark, light, then the transparent index and one unused entry
+    Color colors[4] = {writer->darkColor, writer->lightColor, writer->darkColor, writer->darkColor};
+    for (int i = 0; i < 4; i++) {
+        fputc(colors[i].r, file);
+        fputc(colors[i].g, file);
+        fputc(colors[i].b, file);
+    }
+
+    // Loop forever
+    fwrite("\x21\xff\x0bNETSCAPE2.0\x03\x01\x00\x00\x00", 1, 19, file);
+    return !ferror(file);
+}
+
+
+static bool WriteGifFrame(AnimationWriter* writer, const ExportFrame* frame, int endMs) {
+    FILE* file = writer->file;
+
+    // Rounding both ends instead of the difference keeps the total in sync with the source
+    int delay = (endMs + 5) / 10 - (frame->startMs + 5) / 10;
+    if (delay < GIF_MIN_DELAY_MS / 10) delay = GIF_MIN_DELAY_MS / 10;
+    if (delay > 0xffff) delay = 0xffff;
+
+    // Graphic control: leave the frame in place, INDEX_UNCHANGED is transparent
+    fwrite("\x21\xf9\x04\x05", 1, 4, file);
+    PutShortLE(file, delay);
+    fputc(INDEX_UNCHANGED, file);
+    fputc(0, file);
+
+    fputc(0x2c, file);
+    PutShortLE(file, frame->x);
+    PutShortLE(file, frame->y);
+    PutShortLE(file, frame->width);
+    PutShortLE(file, frame->height);
+    fputc(0, file);
+
+    fwrite(frame->data, 1, frame->size, file);
+    return !ferror(file);
+}
+
+
+//----------------------------------------------------------------------------------
+// APNG
+//----------------------------------------------------------------------------------
+
+static unsigned int crcTable[256];
+static pthread_once_t crcTableOnce = PTHREAD_ONCE_INIT;
+
+
+static void BuildCrcTable(void) {
+    for (unsigned int n = 0; n < 256; n++) {
+        unsigned int c = n;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        crcTable[n] = c;
+    }
+}
+
+
+static unsigned int Crc32(unsigned int crc, const unsigned char* data, size_t size) {
+    // The export queue runs APNG exports side by side, whichever gets here first builds the table
+    pthread_once(&crcTableOnce, BuildCrcTable);
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) crc = crcTable[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+
+static void PutIntBE(unsigned char* out, unsigned int value) {
+    out[0] = (value >> 24) & 0xff;
+    out[1] = (value >> 16) & 0xff;
+    out[2] = (value >> 8) & 0xff;
+    out[3] = value & 0xff;
+}
+
+
+// header is written straight after the type (sequence numbers and such), data after that.
+static void WritePngChunk(FILE* file, const char* type, const unsigned char* header, size_t headerSize, const unsigned char* data, size_t dataSize) {
+    unsigned char bytes[4];
+    PutIntBE(bytes, (unsigned int)(headerSize + dataSize));
+    fwrite(bytes, 1, 4, file);
+
+    unsigned int crc = Crc32(0, (const unsigned char*)type, 4);
+    fwrite(type, 1, 4, file);
+    if (headerSize > 0) {
+        crc = Crc32(crc, header, headerSize);
+        fwrite(header, 1, headerSize, file);
+    }
+    if (dataSize > 0) {
+        crc = Crc32(crc, data, dataSize);
+        fwrite(data, 1, dataSize, file);
+    }
+
+    PutIntBE(bytes, crc);
+    fwrite(bytes, 1, 4, file);
+}
+
+
+// Packs deflate's LSB first bit stream straight into the frame.
+typedef struct {
+    ExportFrame* frame;
+    unsigned int bits;
+    int bitCount;
+} DeflateBitWriter;
+
+static const short deflateLengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const unsigned char deflateLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const int deflateDistanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const unsigned char deflateDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+
+static void WriteDeflateBits(DeflateBitWriter* writer, unsigned int value, int count) {
+    writer->bits |= value << writer->bitCount;
+    writer->bitCount += count;
+    while (writer->bitCount >= 8) {
+        unsigned char byte = (unsigned char)writer->bits;
+        AppendBytes(writer->frame, &byte, 1);
+        writer->bits >>= 8;
+        writer->bitCount -= 8;
+    }
+}
+
+
+// Huffman codes go out MSB first, unlike everything else in the stream
+static void WriteDeflateCode(DeflateBitWriter* writer, int code, int length) {
+    unsigned int reversed = 0;
+    for (int i = 0; i < length; i++) reversed |= ((code >> i) & 1) << (length - 1 - i);
+    WriteDeflateBits(writer, reversed, length);
+}
+
+
+// Literal/length symbol in the fixed Huffman code
+static void WriteDeflateSymbol(DeflateBitWriter* writer, int symbol) {
+    if (symbol < 144) WriteDeflateCode(writer, 0x30 + symbol, 8);
+    else if (symbol < 256) WriteDeflateCode(writer, 0x190 + symbol - 144, 9);
+    else if (symbol < 280) WriteDeflateCode(writer, symbol - 256, 7);
+    else WriteDeflateCode(writer, 0xc0 + symbol - 280, 8);
+}
+
+
+static void WriteDeflateMatch(DeflateBitWriter* writer, int length, int distance) {
+    int code = 28;
+    while (deflateLengthBase[code] > length) code--;
+    WriteDeflateSymbol(writer, 257 + code);
+    if (deflateLengthExtra[code] > 0) WriteDeflateBits(writer, length - deflateLengthBase[code], deflateLengthExtra[code]);
+
+    code = 29;
+    while (deflateDistanceBase[code] > distance) code--;
+    WriteDeflateCode(writer, code, 5);
+    if (deflateDistanceExtra[code] > 0) WriteDeflateBits(writer, distance - deflateDistanceBase[code], deflateDistanceExtra[code]);
+}
+
+
+static unsigned int DeflateHash(const unsigned char* bytes) {
+    unsigned int key = (unsigned int)bytes[0] << 16 | (unsigned int)bytes[1] << 8 | bytes[2];
+    return (key * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+}
+
+
+// One fixed Huffman block with greedy LZ77 matching, the most recent position per hash and nothing else.
+// Dithered rows are a handful of byte patterns repeated over and over, a proper zlib only does a little better here.
+static void DeflateFixed(ExportFrame* frame, const unsigned char* data, int size, int* head) {
+    DeflateBitWriter writer = {frame, 0, 0};
+    WriteDeflateBits(&writer, 1, 1);  // Last block
+    WriteDeflateBits(&writer, 1, 2);  // Fixed codes
+    for (int i = 0; i < DEFLATE_HASH_SIZE; i++) head[i] = -1;
+
+    int position = 0;
+    while (position < size) {
+        int length = 0;
+        int distance = 0;
+        if (position + DEFLATE_MIN_MATCH <= size) {
+            unsigned int hash = DeflateHash(data + position);
+            int candidate = head[hash];
+            head[hash] = position;
+            if (candidate >= 0 && position - candidate <= DEFLATE_WINDOW) {
+                int limit = (size - position < DEFLATE_MAX_MATCH) ? size - position : DEFLATE_MAX_MATCH;
+                while (length < limit && data[candidate + length] == data[position + length]) length++;
+                distance = position - candidate;
+            }
+        }
+
+        if (length >= DEFLATE_MIN_MATCH) {
+            WriteDeflateMatch(&writer, length, distance);
+            // Positions inside the match are still worth finding later
+            for (int i = position + 1; i < position + length && i + DEFLATE_MIN_MATCH <= size; i++) head[DeflateHash(data + i)] = i;
+            position += length;
+        } else {
+            WriteDeflateSymbol(&writer, data[position]);
+            position++;
+        }
+    }
+
+    WriteDeflateSymbol(&writer, 256);  // End of block
+    if (writer.bitCount > 0) WriteDeflateBits(&writer, 0, 8 - writer.bitCount);
+}
+
+
+// 2 bit palette rows with no filtering (the usual advice for palette images), wrapped up as a zlib stream.
+static void EncodeApngFrame(ExportFrame* frame, unsigned char* scratch, int* deflateHead) {
+    int rowBytes = 1 + (frame->width*2 + 7) / 8;
+    int rawSize = rowBytes * frame->height;
+    memset(scratch, 0, rawSize);
+    for (int y = 0; y < frame->height; y++) {
+        unsigned char* row = scratch + y*rowBytes + 1;
+        const unsigned char* indices = frame->indices + y*frame->width;
+        for (int x = 0; x < frame->width; x++) row[x >> 2] |= indices[x] << (6 - 2*(x & 3));
+    }
+
+    unsigned int a = 1, b = 0;
+    for (int i = 0; i < rawSize; i++) {
+        a = (a + scratch[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    unsigned char header[2] = {0x78, 0x01};
+    unsigned char adler[4];
+    PutIntBE(adler, (b << 16) | a);
+
+    frame->size = 0;
+    AppendBytes(frame, header, 2);
+    DeflateFixed(frame, scratch, rawSize, deflateHead);
+    AppendBytes(frame, adler, 4);
+}
+
+
+static bool BeginApng(AnimationWriter* writer) {
+    FILE* file = writer->file;
+    fwrite("\x89PNG\r\n\x1a\n", 1, 8, file);
+
+    unsigned char ihdr[13] = {0};
+    PutIntBE(ihdr, writer->width);
+    PutIntBE(ihdr + 4, writer->height);
+    ihdr[8] = 2;  // Bit depth
+    ihdr[9] = 3;  // Palette
+    WritePngChunk(file, "IHDR", ihdr, sizeof(ihdr), NULL, 0);
+
+    // Frame count isn't known yet, EndApng comes back for it
+    writer->actlOffset = ftell(file);
+    unsigned char actl[8] = {0};
+    WritePngChunk(file, "acTL", actl, sizeof(actl), NULL, 0);
+
+    Color colors[3] = {writer->darkColor, writer->lightColor, writer->darkColor};
+    unsigned char plte[9];
+    for (int i = 0; i < 3; i++) {
+        plte[3*i] = colors[i].r;
+        plte[3*i + 1] = colors[i].g;
+        plte[3*i + 2] = colors[i].b;
+    }
+    WritePngChunk(file, "PLTE", plte, sizeof(plte), NULL, 0);
+
+    unsigned char trns[3] = {255, 255, 0};
+    WritePngChunk(file, "tRNS", trns, sizeof(trns), NULL, 0);
+
+    return !ferror(file);
+}
+
+
+static bool WriteApngFrame(AnimationWriter* writer, const ExportFrame* frame, int endMs) {
+    int delay = endMs - frame->startMs;
+    if (delay < 1) delay = 1;
+    if (delay > 0xffff) delay = 0xffff;
+
+    unsigned char fctl[26];
+    PutIntBE(fctl, writer->sequence++);
+    PutIntBE(fctl + 4, frame->width);
+    PutIntBE(fctl + 8, frame->height);
+    PutIntBE(fctl + 12, frame->x);
+    PutIntBE(fctl + 16, frame->y);
+    fctl[20] = (delay >> 8) & 0xff;
+    fctl[21] = delay & 0xff;
+    fctl[22] = 1000 >> 8;
+    fctl[23] = 1000 & 0xff;
+    fctl[24] = 0;                                   // Dispose: none
+    fctl[25] = (writer->frameCount == 0) ? 0 : 1;   // Blend: source for the first frame, over after that
+    WritePngChunk(writer->file, "fcTL", fctl, sizeof(fctl), NULL, 0);
+
+    // The first frame doubles as the still image for viewers that don't know APNG
+    if (writer->frameCount == 0) {
+        WritePngChunk(writer->file, "IDAT", NULL, 0, frame->data, frame->size);
+    } else {
+        unsigned char sequence[4];
+        PutIntBE(sequence, writer->sequence++);
+        WritePngChunk(writer->file, "fdAT", sequence, 4, frame->data, frame->size);
+    }
+
+    writer->frameCount++;
+    return !ferror(writer->file);
+}
+
+
+static bool EndApng(AnimationWriter* writer) {
+    FILE* file = writer->file;
+    WritePngChunk(file, "IEND", NULL, 0, NULL, 0);
+
+    unsigned char actl[8] = {0};  // Plays stays 0, loop forever
+    PutIntBE(actl, writer->frameCount);
+    fseek(file, writer->actlOffset, SEEK_SET);
+    WritePngChunk(file, "acTL", actl, sizeof(actl), NULL, 0);
+    fseek(file, 0, SEEK_END);
+
+    return !ferror(file);
+}
+
+
+//----------------------------------------------------------------------------------
+// WebP
+//----------------------------------------------------------------------------------
+
+// Lossless animated WebP is its own codec (VP8L), so this one leans on FFmpeg's libwebp wrapper.
+// libwebp only encodes one frame at a time and finds its own sub-rectangles, so frames are fed in whole.
+static bool BeginWebp(AnimationWriter* writer, const char* path) {
+    const AVCodec* codec = avcodec_find_encoder_by_name("libwebp_anim");
+    if (codec == NULL) {
+        TraceLog(LOG_WARNING, "Export: this FFmpeg build can't write animated WebP (no libwebp)");
+        return false;
+    }
+    if (avformat_alloc_output_context2(&writer->muxer, NULL, "webp", path) < 0 || writer->muxer == NULL) return false;
+
+    writer->encoder = avcodec_alloc_context3(codec);
+    writer->encoder->width = writer->width;
+    writer->encoder->height = writer->height;
+    writer->encoder->pix_fmt = AV_PIX_FMT_RGB32;
+    writer->encoder->time_base = (AVRational){1, 1000};
+    av_opt_set_int(writer->encoder->priv_data, "lossless", 1, 0);
+    if (avcodec_open2(writer->encoder, codec, NULL) < 0) {
+        TraceLog(LOG_WARNING, "Export: couldn't open the WebP encoder");
+        return false;
+    }
+
+    AVStream* stream = avformat_new_stream(writer->muxer, NULL);
+    avcodec_parameters_from_context(stream->codecpar, writer->encoder);
+    stream->time_base = writer->encoder->time_base;
+
+    if (avio_open(&writer->muxer->pb, path, AVIO_FLAG_WRITE) < 0) return false;
+    AVDictionary* muxerOptions = NULL;
+    av_dict_set(&muxerOptions, "loop", "0", 0);
+    int result = avformat_write_header(writer->muxer, &muxerOptions);
+    av_dict_free(&muxerOptions);
+    if (result < 0) return false;
+
+    writer->frame = av_frame_alloc();
+    writer->frame->format = AV_PIX_FMT_RGB32;
+    writer->frame->width = writer->width;
+    writer->frame->height = writer->height;
+    av_frame_get_buffer(writer->frame, 0);
+    writer->packet = av_packet_alloc();
+    writer->canvas = (unsigned char*)calloc((size_t)writer->width * writer->height, 1);
+
+    return true;
+}
+
+
+static bool EncodeWebpFrame(AnimationWriter* writer, AVFrame* frame) {
+    if (avcodec_send_frame(writer->encoder, frame) < 0) return false;
+
+    for (;;) {
+        int result = avcodec_receive_packet(writer->encoder, writer->packet);
+        if (result == AVERROR(EAGAIN) || result == AVERROR_EOF) return true;
+        if (result < 0) return false;
+
+        av_packet_rescale_ts(writer->packet, writer->encoder->time_base, writer->muxer->streams[0]->time_base);
+        writer->packet->stream_index = 0;
+        if (av_interleaved_write_frame(writer->muxer, writer->packet) < 0) return false;
+    }
+}
+
+
+static bool WriteWebpFrame(AnimationWriter* writer, const ExportFrame* frame, int endMs) {
+    // Put the changed region back on the full canvas
+    for (int y = 0; y < frame->height; y++) {
+        const unsigned char* indices = frame->indices + y*frame->width;
+        unsigned char* canvas = writer->canvas + (size_t)(frame->y + y)*writer->width + frame->x;
+        for (int x = 0; x < frame->width; x++) {
+            if (indices[x] != INDEX_UNCHANGED) canvas[x] = indices[x];
+        }
+    }
+
+    // RGB32 is a native endian 0xAARRGGBB
+    Color colors[2] = {writer->darkColor, writer->lightColor};
+    uint32_t pixels[2];
+    for (int i = 0; i < 2; i++) pixels[i] = 0xff000000u | (colors[i].r << 16) | (colors[i].g << 8) | colors[i].b;
+
+    if (av_frame_make_writable(writer->frame) < 0) return false;
+    for (int y = 0; y < writer->height; y++) {
+        uint32_t* row = (uint32_t*)(writer->frame->data[0] + (size_t)y*writer->frame->linesize[0]);
+        const unsigned char* canvas = writer->canvas + (size_t)y*writer->width;
+        for (int x = 0; x < writer->width; x++) row[x] = pixels[canvas[x]];
+    }
+    writer->frame->pts = frame->startMs;
+    writer->frame->duration = endMs - frame->startMs;
+
+    return EncodeWebpFrame(writer, writer->frame);
+}
+
+
+static bool EndWebp(AnimationWriter* writer) {
+    if (!EncodeWebpFrame(writer, NULL)) return false;
+    return av_write_trailer(writer->muxer) == 0;
+}
+
+
+//----------------------------------------------------------------------------------
+// Writer
+//----------------------------------------------------------------------------------
+
+static bool BeginAnimation(AnimationWriter* writer, const char* path) {
+    if (writer->format == EXPORT_FORMAT_WEBP) return BeginWebp(writer, path);
+
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL) {
+        TraceLog(LOG_WARNING, "Export: couldn't open %s for writing", path);
+        return false;
+    }
+    return (writer->format == EXPORT_FORMAT_GIF) ? BeginGif(writer) : BeginApng(writer);
+}
+
+
+// endMs is when the next frame replaces this one.
+static bool WriteAnimationFrame(AnimationWriter* writer, const ExportFrame* frame, int endMs) {
+    switch (writer->format) {
+        case EXPORT_FORMAT_GIF: return WriteGifFrame(writer, frame, endMs);
+        case EXPORT_FORMAT_APNG: return WriteApngFrame(writer, frame, endMs);
+        default: return WriteWebpFrame(writer, frame, endMs);
+    }
+}
+
+
+static bool EndAnimation(AnimationWriter* writer) {
+    switch (writer->format) {
+        case EXPORT_FORMAT_GIF:
+            fputc(0x3b, writer->file);
+            return !ferror(writer->file);
+        case EXPORT_FORMAT_APNG: return EndApng(writer);
+        default: return EndWebp(writer);
+    }
+}
+
+
+static bool CloseAnimation(AnimationWriter* writer) {
+    bool ok = true;
+    if (writer->file != NULL) ok = fclose(writer->file) == 0;
+
+    av_frame_free(&writer->frame);
+    av_packet_free(&writer->packet);
+    avcodec_free_context(&writer->encoder);
+    if (writer->muxer != NULL) {
+        if (writer->muxer->pb != NULL) ok = (avio_closep(&writer->muxer->pb) == 0) && ok;
+        avformat_free_context(writer->muxer);
+    }
+    free(writer->canvas);
+
+    return ok;
+}
+
+
+//----------------------------------------------------------------------------------
+// Frames
+//----------------------------------------------------------------------------------
+
+// Bounding box of the pixels that differ, false if nothing does.
+static bool FindChangedRect(const unsigned char* previous, const unsigned char* current, int width, int height, ExportFrame* frame) {
+    size_t rowSize = width;
+    int top = 0;
+    while (top < height && memcmp(previous + top*rowSize, current + top*rowSize, rowSize) == 0) top++;
+    if (top == height) return false;
+
+    int bottom = height - 1;
+    while (memcmp(previous + bottom*rowSize, current + bottom*rowSize, rowSize) == 0) bottom--;
+
+    int left = width;
+    int right = -1;
+    for (int y = top; y <= bottom; y++) {
+        const unsigned char* a = previous + y*rowSize;
+        const unsigned char* b = current + y*rowSize;
+        for (int x = 0; x < left; x++) {
+            if (a[x] != b[x]) {
+                left = x;
+                break;
+            }
+        }
+        for (int x = width - 1; x > right; x--) {
+            if (a[x] != b[x]) {
+                right = x;
+                break;
+            }
+        }
+    }
+
+    frame->x = left;
+    frame->y = top;
+    frame->width = right - left + 1;
+    frame->height = bottom - top + 1;
+    return true;
+}
+
+
+// previous == NULL takes the whole frame as is.
+static void FillFrameIndices(ExportFrame* frame, const unsigned char* previous, const unsigned char* current, int width) {
+    for (int y = 0; y < frame->height; y++) {
+        size_t offset = (size_t)(frame->y + y)*width + frame->x;
+        unsigned char* out = frame->indices + y*frame->width;
+        for (int x = 0; x < frame->width; x++) {
+            unsigned char index = current[offset + x];
+            out[x] = (previous == NULL || previous[offset + x] != index) ? index : INDEX_UNCHANGED;
+        }
+    }
+}
+
+
+static void* EncodeWorkerMain(void* arg) {
+    EncodeBatch* batch = (EncodeBatch*)arg;
+    if (batch->background) LowerThreadPriority();
+
+    // Scratch for whichever format this is
+    LzwTable* table = NULL;
+    unsigned char* raw = NULL;
+    int* deflateHead = NULL;
+    if (batch->format == EXPORT_FORMAT_GIF) table = (LzwTable*)malloc(sizeof(LzwTable));
+    if (batch->format == EXPORT_FORMAT_APNG) {
+        raw = (unsigned char*)malloc((size_t)(1 + (batch->width*2 + 7) / 8) * batch->height);
+        deflateHead = (int*)malloc(sizeof(int) * DEFLATE_HASH_SIZE);
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&batch->lock);
+        int index = batch->next++;
+        pthread_mutex_unlock(&batch->lock);
+        if (index >= batch->count) break;
+
+        ExportFrame* frame = &batch->frames[index];
+        if (batch->format == EXPORT_FORMAT_GIF) EncodeGifFrame(frame, table);
+        else EncodeApngFrame(frame, raw, deflateHead);
+        frame->encoded = frame->size > 0;
+    }
+
+    free(table);
+    free(raw);
+    free(deflateHead);
+    return NULL;
+}
+
+
+// Frames don't depend on each other once their rectangles are known, so each one can be compressed on its own thread.
+static void EncodeFrames(ExportFrame* frames, int count, ExportFormat format, int width, int height, int threads, bool background) {
+    if (format == EXPORT_FORMAT_WEBP) {
+        for (int i = 0; i < count; i++) frames[i].encoded = true;
+        return;
+    }
+
+    EncodeBatch batch = {frames, count, 0, width, height, format, background};
+    pthread_mutex_init(&batch.lock, NULL);
+
+    if (threads > count) threads = count;
+    pthread_t workers[EXPORT_MAX_THREADS];
+    int started = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&workers[started], NULL, EncodeWorkerMain, &batch) == 0) started++;
+    }
+    EncodeWorkerMain(&batch);
+    for (int i = 0; i < started; i++) pthread_join(workers[i], NULL);
+
+    pthread_mutex_destroy(&batch.lock);
+}
+
+
+static void DitherFrame(unsigned char* planes[3], const int strides[3], unsigned char* mask, int width, int height) {
+    for (int row = 0; row < height; row++) {
+        DitherRowYUV(planes[0] + (size_t)row*strides[0], planes[1] + (size_t)(row/2)*strides[1], planes[2] + (size_t)(row/2)*strides[2],
+                     mask + (size_t)row*width, width, height - 1 - row);
+    }
+}
+
+
+bool ExportAnimation(const char* inputPath, const char* outputPath, const ExportOptions* options) {
+    int threads = (options->threads > 0) ? options->threads : GetProcessorCount();
+    if (threads > EXPORT_MAX_THREADS) threads = EXPORT_MAX_THREADS;
+
+    bool fit = options->fit && options->width > 0 && options->height > 0;
+    VideoDecoder* decoder = OpenVideoDecoder(inputPath, fit ? 0 : options->width, fit ? 0 : options->height, threads);
+    if (decoder == NULL) return false;
+    if (fit) {
+        // Same fit as the player, so the dither pattern comes out the way it looked
+        float scale = fminf((float)options->width / GetVideoDecoderWidth(decoder), (float)options->height / GetVideoDecoderHeight(decoder));
+        int fitWidth = (int)(GetVideoDecoderWidth(decoder) * scale);
+        int fitHeight = (int)(GetVideoDecoderHeight(decoder) * scale);
+        SetVideoDecoderSize(decoder, (fitWidth > 0) ? fitWidth : 1, (fitHeight > 0) ? fitHeight : 1);
+    }
+
+    int width = GetVideoDecoderWidth(decoder);
+    int height = GetVideoDecoderHeight(decoder);
+    double duration = GetVideoDecoderDuration(decoder);
+    int frameMs = (int)lround(1000.0 / GetVideoDecoderFrameRate(decoder));
+    int minIntervalMs = (options->format == EXPORT_FORMAT_GIF) ? GIF_MIN_DELAY_MS : 0;
+
+    AnimationWriter writer = {0};
+    writer.format = options->format;
+    writer.width = width;
+    writer.height = height;
+    writer.lightColor = options->lightColor;
+    writer.darkColor = options->darkColor;
+    if (!BeginAnimation(&writer, outputPath)) {
+        CloseAnimation(&writer);
+        remove(outputPath);
+        CloseVideoDecoder(decoder);
+        return false;
+    }
+
+    // Everything is sized for the full frame once, a change rectangle never needs more
+    size_t frameSize = (size_t)width * height;
+    int chromaWidth = (width + 1) / 2;
+    unsigned char* yuv = (unsigned char*)malloc(frameSize + 2 * (size_t)chromaWidth * ((height + 1) / 2));
+    unsigned char* planes[3] = {yuv, yuv + frameSize, yuv + frameSize + (size_t)chromaWidth * ((height + 1) / 2)};
+    int strides[3] = {width, chromaWidth, chromaWidth};
+    unsigned char* current = (unsigned char*)malloc(frameSize);
+    unsigned char* previous = (unsigned char*)malloc(frameSize);
+
+    ExportFrame frames[EXPORT_BATCH_SIZE] = {0};
+    ExportFrame pending = {0};
+    for (int i = 0; i < EXPORT_BATCH_SIZE; i++) frames[i].indices = (unsigned char*)malloc(frameSize);
+    pending.indices = (unsigned char*)malloc(frameSize);
+
+    bool ok = true;
+    bool cancelled = false;
+    bool done = false;
+    bool havePrevious = false;
+    bool havePending = false;
+    double firstTimestamp = -1.0;
+    int lastMs = 0;
+    int keptMs = 0;
+    long long decodedCount = 0;
+    long long keptCount = 0;
+    double startTime = GetMonotonicTime();
+
+    while (ok && !done) {
+        int count = 0;
+        while (count < EXPORT_BATCH_SIZE) {
+            while (options->pause != NULL && *options->pause && !(options->cancel != NULL && *options->cancel)) SleepSeconds(0.05);
+            if (options->cancel != NULL && *options->cancel) {
+                cancelled = true;
+                break;
+            }
+
+            double timestamp;
+            if (!DecodeVideoFrame(decoder, planes, strides, &timestamp)) {
+                done = true;
+                break;
+            }
+            decodedCount++;
+            if (firstTimestamp < 0) firstTimestamp = timestamp;
+            lastMs = (int)lround((timestamp - firstTimestamp) * 1000.0);
+            if (options->progress != NULL && duration > 0) *options->progress = fminf((float)(timestamp / duration), 1.0f);
+
+            if (havePrevious && lastMs - keptMs < minIntervalMs) continue;
+
+            DitherFrame(planes, strides, current, width, height);
+            ExportFrame* frame = &frames[count];
+            if (!havePrevious) {
+                *frame = (ExportFrame){0, 0, width, height, 0, frame->indices, frame->data, 0, frame->capacity};
+            } else if (!FindChangedRect(previous, current, width, height, frame)) {
+                // Same as the last kept frame, which just stays up longer
+                continue;
+            }
+            FillFrameIndices(frame, havePrevious ? previous : NULL, current, width);
+            frame->startMs = lastMs;
+
+            unsigned char* swap = previous;
+            previous = current;
+            current = swap;
+            havePrevious = true;
+            keptMs = lastMs;
+            count++;
+        }
+        if (cancelled) break;
+
+        EncodeFrames(frames, count, options->format, width, height, threads, options->background);
+
+        // Each frame's delay is only known once the next one shows up, so writing lags one behind
+        for (int i = 0; i < count && ok; i++) {
+            if (!frames[i].encoded) ok = false;
+            if (ok && havePending) ok = WriteAnimationFrame(&writer, &pending, frames[i].startMs);
+
+            ExportFrame swap = pending;
+            pending = frames[i];
+            frames[i] = swap;
+            havePending = true;
+            keptCount++;
+        }
+    }
+
+    if (ok && !cancelled) {
+        if (havePending) ok = WriteAnimationFrame(&writer, &pending, lastMs + frameMs);
+        else ok = false;
+        ok = ok && EndAnimation(&writer);
+    }
+    ok = CloseAnimation(&writer) && ok && !cancelled;
+
+    if (ok) {
+        TraceLog(LOG_INFO, "Export: %s, %lld of %lld frames kept, %.2fs", outputPath, keptCount, decodedCount, GetMonotonicTime() - startTime);
+    } else {
+        TraceLog(LOG_WARNING, "Export: %s %s", outputPath, cancelled ? "cancelled" : "failed");
+        remove(outputPath);
+    }
+
+    for (int i = 0; i < EXPORT_BATCH_SIZE; i++) {
+        free(frames[i].indices);
+        free(frames[i].data);
+    }
+    free(pending.indices);
+    free(pending.data);
+    free(current);
+    free(previous);
+    free(yuv);
+    CloseVideoDecoder(decoder);
+
+    return ok;
+}
@@ -0,0 +1,39 @@
+#ifndef ANIMEXPORT_H
+#define ANIMEXPORT_H
+
+#include "raylib.h"
+#include <stdatomic.h>
+
+// Writes a video out as a looping animated image, dithered to the two palette colors.
+// Frames that don't change are merged into the previous one, and every other frame only stores
+// the rectangle that changed. Pixels inside that rectangle that stayed the same are transparent.
+
+typedef enum {
+    EXPORT_FORMAT_GIF,
+    EXPORT_FORMAT_APNG,
+    EXPORT_FORMAT_WEBP,  // Needs an FFmpeg build with libwebp
+} ExportFormat;
+
+typedef struct {
+    ExportFormat format;
+    int width;                // Both 0 keeps the source size
+    int height;
+    bool fit;                 // width x height is a box the video is scaled into, keeping its aspect ratio
+    Color lightColor;
+    Color darkColor;
+    int threads;              // Encoder and decoder threads, 0 picks from the core count
+    bool background;          // Encoder threads run below normal priority
+    // Shared with whoever started the export, which is usually another thread
+    _Atomic float* progress;  // Optional, goes 0 to 1 as the input is read
+    atomic_bool* cancel;      // Optional, checked between frames
+    atomic_bool* pause;       // Optional, while it's set the export waits between frames
+} ExportOptions;
+
+// By extension: .gif, .png/.apng, .webp
+bool GetExportFormat(const char* fileName, ExportFormat* format);
+
+// Blocks until done. Safe to run off the main thread, nothing in here touches the GPU.
+// On failure or cancel the partial output is deleted.
+bool ExportAnimation(const char* inputPath, const char* outputPath, const ExportOptions* options);
+
+#endif
@@ -0,0 +1,276 @@
+#include "appmem.h"
+#include "raylib.h"
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGNMENT 16
+
+// Arena overflow, freed at the start of the next frame
+typedef struct ArenaSpill {
+    struct ArenaSpill* next;
+} ArenaSpill;
+
+// Frame buffers carry their capacity in front, padded so the data stays aligned
+typedef struct {
+    size_t capacity;
+    char padding[ARENA_ALIGNMENT - sizeof(size_t)];
+} FrameBufferHeader;
+
+struct StringPoolBlock {
+    StringPoolBlock* next;
+    size_t used;
+    size_t capacity;
+    char data[];
+};
+
+static struct {
+    unsigned char* arena;
+    size_t arenaUsed;
+    ArenaSpill* spills;
+
+    void* freeBuffers[FRAME_BUFFER_POOL_SIZE];
+    int freeBufferCount;
+
+    int frameAllocations;
+    long long liveAllocations;
+    bool steadyWarned;
+} appMemory = {0};
+
+
+void* AppAlloc(size_t size) {
+    void* pointer = malloc(size);
+    if (pointer != NULL) {
+        appMemory.frameAllocations++;
+        appMemory.liveAllocations++;
+    }
+    return pointer;
+}
+
+
+void* AppRealloc(void* pointer, size_t size) {
+    void* result = realloc(pointer, size);
+    if (result != NULL) {
+        appMemory.frameAllocations++;
+        if (pointer == NULL) appMemory.liveAllocations++;
+    }
+    return result;
+}
+
+
+void AppFree(void* pointer) {
+    if (pointer == NULL) return;
+    free(pointer);
+    appMemory.liveAllocations--;
+}
+
+
+void InitAppMemory(void) {
+    appMemory.arena = (unsigned char*)AppAlloc(FRAME_ARENA_SIZE);
+    appMemory.arenaUsed = 0;
+}
+
+
+void UnloadAppMemory(void) {
+    BeginAppFrame();
+    for (int i = 0; i < appMemory.freeBufferCount; i++) AppFree(appMemory.freeBuffers[i]);
+    appMemory.freeBufferCount = 0;
+    AppFree(appMemory.arena);
+    appMemory.arena = NULL;
+
+    if (appMemory.liveAllocations != 0) TraceLog(LOG_WARNING, "Memory: %lld allocations never freed", appMemory.liveAllocations);
+}
+
+
+void BeginAppFrame(void) {
+    appMemory.arenaUsed = 0;
+    while (appMemory.spills != NULL) {
+        ArenaSpill* next = appMemory.spills->next;
+        AppFree(appMemory.spills);
+        appMemory.spills = next;
+    }
+    appMemory.frameAllocations = 0;
+}
+
+
+void EndAppFrame(bool steady) {
+    if (!steady || appMemory.frameAllocations == 0) return;
+
+    // Logged once, a kiosk left running for a week doesn't need a line per frame
+    if (!appMemory.steadyWarned) {
+        TraceLog(LOG_WARNING, "Memory: %d heap allocations during playback, the frame loop should be allocation free", appMemory.frameAllocations);
+        appMemory.steadyWarned = true;
+    }
+#if defined(_DEBUG)
+    assert(appMemory.frameAllocations == 0 && "heap allocation in a steady frame");
+#endif
+}
+
+
+int GetFrameAllocationCount(void) {
+    return appMemory.frameAllocations;
+}
+
+
+long long GetLiveAllocationCount(void) {
+    return appMemory.liveAllocations;
+}
+
+
+void* FrameAlloc(size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    if (appMemory.arena != NULL && appMemory.arenaUsed + size <= FRAME_ARENA_SIZE) {
+        void* pointer = appMemory.arena + appMemory.arenaUsed;
+        appMemory.arenaUsed += size;
+        return pointer;
+    }
+
+    ArenaSpill* spill = (ArenaSpill*)AppAlloc(ARENA_ALIGNMENT + size);
+    if (spill == NULL) return NULL;
+    spill->next = appMemory.spills;
+    appMemory.spills = spill;
+    return (unsigned char*)spill + ARENA_ALIGNMENT;
+}
+
+
+const char* FrameTextFormat(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (length < 0) return "";
+
+    char* text = (char*)FrameAlloc(length + 1);
+    if (text == NULL) return "";
+    va_start(args, format);
+    vsnprintf(text, length + 1, format, args);
+    va_end(args);
+    return text;
+}
+
+
+void* AcquireFrameBuffer(size_t size) {
+    // Smallest pooled buffer that fits
+    int best = -1;
+    for (int i = 0; i < appMemory.freeBufferCount; i++) {
+        FrameBufferHeader* header = (FrameBufferHeader*)appMemory.freeBuffers[i];
+        if (header->capacity >= size && (best < 0 || header->capacity < ((FrameBufferHeader*)appMemory.freeBuffers[best])->capacity)) best = i;
+    }
+
+    FrameBufferHeader* header = NULL;
+    if (best >= 0) {
+        header = (FrameBufferHeader*)appMemory.freeBuffers[best];
+        appMemory.freeBuffers[best] = appMemory.freeBuffers[--appMemory.freeBufferCount];
+    } else {
+        header = (FrameBufferHeader*)AppAlloc(sizeof(FrameBufferHeader) + size);
+        if (header == NULL) return NULL;
+        header->capacity = size;
+    }
+    return header + 1;
+}
+
+
+void ReleaseFrameBuffer(void* buffer) {
+    if (buffer == NULL) return;
+    FrameBufferHeader* header = (FrameBufferHeader*)buffer - 1;
+
+    if (appMemory.freeBufferCount == FRAME_BUFFER_POOL_SIZE) {
+        // Pool is full, drop the smallest one (the newcomer included)
+        int smallest = -1;
+        size_t smallestCapacity = header->capacity;
+        for (int i = 0; i < appMemory.freeBufferCount; i++) {
+            size_t capacity = ((FrameBufferHeader*)appMemory.freeBuffers[i])->capacity;
+            if (capacity < smallestCapacity) {
+                smallest = i;
+                smallestCapacity = capacity;
+            }
+        }
+        if (smallest < 0) {
+            AppFree(header);
+            return;
+        }
+        AppFree(appMemory.freeBuffers[smallest]);
+        appMemory.freeBuffers[smallest] = header;
+        return;
+    }
+
+    appMemory.freeBuffers[appMemory.freeBufferCount++] = header;
+}
+
+
+static char* PoolReserve(StringPool* pool, size_t size) {
+    // Next block with room, reusing blocks kept from before the last reset
+    while (pool->current != NULL && pool->current->used + size > pool->current->capacity) {
+        if (pool->current->next == NULL) break;
+        pool->current = pool->current->next;
+        pool->current->used = 0;
+    }
+
+    if (pool->current == NULL || pool->current->used + size > pool->current->capacity) {
+        size_t capacity = (size > STRING_POOL_BLOCK_SIZE) ? size : STRING_POOL_BLOCK_SIZE;
+        StringPoolBlock* block = (StringPoolBlock*)AppAlloc(sizeof(StringPoolBlock) + capacity);
+        if (block == NULL) return NULL;
+        block->next = NULL;
+        block->used = 0;
+        block->capacity = capacity;
+        if (pool->current != NULL) pool->current->next = block;
+        else pool->first = block;
+        pool->current = block;
+    }
+
+    char* text = pool->current->data + pool->current->used;
+    pool->current->used += size;
+    return text;
+}
+
+
+const char* PoolString(StringPool* pool, const char* text) {
+    size_t size = strlen(text) + 1;
+    char* copy = PoolReserve(pool, size);
+    if (copy == NULL) return "";
+    memcpy(copy, text, size);
+    return copy;
+}
+
+
+const char* PoolStringFormat(StringPool* pool, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (length < 0) return "";
+
+    char* text = PoolReserve(pool, length + 1);
+    if (text == NULL) return "";
+    va_start(args, format);
+    vsnprintf(text, length + 1, format, args);
+    va_end(args);
+    return text;
+}
+
+
+void ResetStringPool(StringPool* pool) {
+    pool->current = pool->first;
+    if (pool->current != NULL) pool->current->used = 0;
+}
+
+
+void UnloadStringPool(StringPool* pool) {
+    while (pool->first != NULL) {
+        StringPoolBlock* next = pool->first->next;
+        AppFree(pool->first);
+        pool->first = next;
+    }
+    pool->current = NULL;
+}
+
+
+void CopyString(char* destination, size_t size, const char* source) {
+    if (size == 0) return;
+    size_t length = strlen(source);
+    if (length >= size) length = size - 1;
+    memmove(destination, source, length);
+    destination[length] = '\0';
+}
@@ -0,0 +1,65 @@
+#ifndef APPMEM_H
+#define APPMEM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Memory for the frame loop, main thread only.
+//   Frame arena: scratch memory that's gone at the end of the frame, allocating is a pointer bump.
+//   Pools: long-lived buffers that are handed out again instead of freed (frame buffers, strings).
+//   Everything else goes through AppAlloc/AppFree, which count, so a frame that hits the heap can be caught
+//   and whatever's still allocated at exit shows up as a leak.
+// Counted: main.c's file list, search results and palettes, frame cache handles, and the shader manager's
+// sources and program binaries (so a hot-reload mid-playback trips the check too). Shader locations aren't,
+// raylib's UnloadShader frees them.
+// Not counted: raylib (it's linked prebuilt, RL_MALLOC can't be pointed here), raylib-media and FFmpeg,
+// and the background threads (library index, exports, frame cache builder) since the counters aren't atomic.
+// A steady frame that passes the check can still have allocated in any of those.
+
+#define FRAME_ARENA_SIZE (256 * 1024)
+#define FRAME_BUFFER_POOL_SIZE 4
+#define STRING_POOL_BLOCK_SIZE (64 * 1024)
+
+void InitAppMemory(void);
+// Logs whatever AppAlloc memory is still live, call once everything else has been cleaned up.
+void UnloadAppMemory(void);
+
+void* AppAlloc(size_t size);
+void* AppRealloc(void* pointer, size_t size);
+void AppFree(void* pointer);
+
+// Everything from the frame arena is released here.
+void BeginAppFrame(void);
+// steady means nothing should be allocating right now (playback that's already running).
+// Heap allocations in a steady frame assert in debug builds and are logged in release builds.
+void EndAppFrame(bool steady);
+int GetFrameAllocationCount(void);
+long long GetLiveAllocationCount(void);
+
+// Valid until the next BeginAppFrame. Spills to the heap (and counts as an allocation) if the arena is full.
+void* FrameAlloc(size_t size);
+// TextFormat without the 4 buffer limit, the result lives until the end of the frame.
+const char* FrameTextFormat(const char* format, ...);
+
+// Buffers for whole frames, at least size bytes. Released buffers are kept for the next acquire.
+void* AcquireFrameBuffer(size_t size);
+void ReleaseFrameBuffer(void* buffer);
+
+// Strings that live until the pool is reset. Blocks are kept on reset, so refilling the pool
+// with about as much as last time doesn't allocate.
+typedef struct StringPoolBlock StringPoolBlock;
+
+typedef struct {
+    StringPoolBlock* first;
+    StringPoolBlock* current;
+} StringPool;
+
+const char* PoolString(StringPool* pool, const char* text);
+const char* PoolStringFormat(StringPool* pool, const char* format, ...);
+void ResetStringPool(StringPool* pool);
+void UnloadStringPool(StringPool* pool);
+
+// Bounded strcpy, always terminates.
+void CopyString(char* destination, size_t size, const char* source);
+
+#endif
@@ -48,6 +48,7 @@ bool eightNinthsOpacity(vec2 coord) {
 
 uniform vec4 lightColor;  // Color for "painted" pixels
 uniform vec4 darkColor;   // Color for "unpainted" pixels
+uniform vec2 patternOrigin;  // Screen position the pattern is anchored to
 
 void main() {
     vec4 texColor = texture(texture0, fragTexCoord);
@@ -55,7 +56,7 @@ void main() {
     float v = hsv.z;
     
     // Use screen-space coordinates instead of texture coordinates
-    vec2 pixelCoord = gl_FragCoord.xy;
+    vec2 pixelCoord = gl_FragCoord.xy - patternOrigin;
     bool paintPixel = false;
     
     if (v <= 1.0/12.0) {
@@ -0,0 +1,93 @@
+#include "ditherkernel.h"
+
+// One 6x6 tile per level (6 being the smallest size both the 2x2 and 3x3 patterns repeat in).
+// Each entry is a row of the tile, bit x set where dither.fs paints lightColor.
+// Rows are counted from the bottom and bits from the left, same as gl_FragCoord.
+static const unsigned char patternRows[7][6] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00},  // nothing
+    {0x00, 0x12, 0x00, 0x00, 0x12, 0x00},  // ninthOpacity
+    {0x00, 0x2a, 0x00, 0x2a, 0x00, 0x2a},  // fourthOpacity
+    {0x15, 0x2a, 0x15, 0x2a, 0x15, 0x2a},  // halfOpacity
+    {0x2a, 0x3f, 0x2a, 0x3f, 0x2a, 0x3f},  // threeFourthsOpacity
+    {0x36, 0x3f, 0x3f, 0x36, 0x3f, 0x3f},  // eightNinthsOpacity
+    {0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f},  // everything
+};
+
+
+int GetDitherLevel(unsigned char value) {
+    // The thresholds from dither.fs (1/12, 1/6, 1/3, 2/3, 6/7, 10/11) in 0-255 terms
+    return (value > 21) + (value > 42) + (value > 85) + (value > 170) + (value > 218) + (value > 231);
+}
+
+
+// Picks the tile row for patternY, so each pixel is just a shift of its level's bits.
+static void LoadPatternRow(unsigned char bits[7], int patternY) {
+    int row = patternY % 6;
+    if (row < 0) row += 6;
+    for (int level = 0; level < 7; level++) bits[level] = patternRows[level][row];
+}
+
+
+static unsigned char Max3(unsigned char a, unsigned char b, unsigned char c) {
+    unsigned char m = (a > b) ? a : b;
+    return (m > c) ? m : c;
+}
+
+
+void DitherRowRGBA(const unsigned char* rgba, unsigned char* mask, int width, int patternY) {
+    unsigned char bits[7];
+    LoadPatternRow(bits, patternY);
+    for (int x = 0, px = 0; x < width; x++, px = (px == 5) ? 0 : px + 1) {
+        mask[x] = (bits[GetDitherLevel(Max3(rgba[4*x], rgba[4*x + 1], rgba[4*x + 2]))] >> px) & 1;
+    }
+}
+
+
+void DitherRowRGB(const unsigned char* rgb, unsigned char* mask, int width, int patternY) {
+    unsigned char bits[7];
+    LoadPatternRow(bits, patternY);
+    for (int x = 0, px = 0; x < width; x++, px = (px == 5) ? 0 : px + 1) {
+        mask[x] = (bits[GetDitherLevel(Max3(rgb[3*x], rgb[3*x + 1], rgb[3*x + 2]))] >> px) & 1;
+    }
+}
+
+
+void DitherRowValues(const unsigned char* values, unsigned char* mask, int width, int patternY) {
+    unsigned char bits[7];
+    LoadPatternRow(bits, patternY);
+    for (int x = 0, px = 0; x < width; x++, px = (px == 5) ? 0 : px + 1) {
+        mask[x] = (bits[GetDitherLevel(values[x])] >> px) & 1;
+    }
+}
+
+
+// max(r, g, b) of a YUV pixel is 298*(y - 16) plus whichever chroma term is biggest.
+static int ChromaPeak(unsigned char u, unsigned char v) {
+    int d = u - 128;
+    int e = v - 128;
+    int r = 409*e;
+    int g = -100*d - 208*e;
+    int b = 516*d;
+    int m = (r > g) ? r : g;
+    return (m > b) ? m : b;
+}
+
+
+static unsigned char ClampValue(int value) {
+    return (value < 0) ? 0 : (value > 255) ? 255 : (unsigned char)value;
+}
+
+
+unsigned char GetYUVValue(unsigned char y, unsigned char u, unsigned char v) {
+    return ClampValue((298*(y - 16) + ChromaPeak(u, v) + 128) >> 8);
+}
+
+
+void DitherRowYUV(const unsigned char* y, const unsigned char* u, const unsigned char* v, unsigned char* mask, int width, int patternY) {
+    unsigned char bits[7];
+    LoadPatternRow(bits, patternY);
+    for (int x = 0, px = 0; x < width; x++, px = (px == 5) ? 0 : px + 1) {
+        int peak = ChromaPeak(u[x/2], v[x/2]) + 128;
+        mask[x] = (bits[GetDitherLevel(ClampValue((298*(y[x] - 16) + peak) >> 8))] >> px) & 1;
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef DITHERKERNEL_H
+#define DITHERKERNEL_H
+
+#include "raylib.h"
+
+// CPU version of dither.fs, for everything that doesn't go through the GPU (pipes, exports).
+// Produces a mask row: 1 where dither.fs paints lightColor, 0 where it paints darkColor.
+//
+// patternY is the row counted from the bottom of the image, like gl_FragCoord.y,
+// so for a top-down buffer of height h it's (h - 1 - row). That keeps CPU output identical to the shader's.
+
+// Dither level (0 = all dark .. 6 = all light) for a brightness value, same thresholds as dither.fs.
+int GetDitherLevel(unsigned char value);
+
+void DitherRowRGBA(const unsigned char* rgba, unsigned char* mask, int width, int patternY);
+void DitherRowRGB(const unsigned char* rgb, unsigned char* mask, int width, int patternY);
+// u and v are at half horizontal resolution (yuv420p / yuv422p chroma rows).
+void DitherRowYUV(const unsigned char* y, const unsigned char* u, const unsigned char* v, unsigned char* mask, int width, int patternY);
+// values are already the HSV value (max of r, g, b) per pixel.
+void DitherRowValues(const unsigned char* values, unsigned char* mask, int width, int patternY);
+
+// Brightness as dither.fs sees it, max(r, g, b) of a BT.601 limited range YUV pixel.
+unsigned char GetYUVValue(unsigned char y, unsigned char u, unsigned char v);
+
+#endif
@@ -0,0 +1,372 @@
+#include "exportqueue.h"
+#include "platform.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+// Below this much progress an ETA is mostly noise from opening the file
+#define EXPORT_ETA_MIN_PROGRESS 0.02f
+
+typedef struct {
+    bool used;
+    int id;
+    char inputPath[512];
+    char outputPath[512];
+    ExportOptions options;
+    ExportJobState state;     // QUEUED, RUNNING or finished, paused is the pause flag on top of that
+    _Atomic float progress;
+    atomic_bool cancel;
+    atomic_bool pause;
+    double startTime;
+    double pausedTime;        // Seconds spent paused while running, left out of the ETA
+    double pauseStart;
+} QueuedExport;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    bool initialized;
+    bool stop;
+
+    // A paused job keeps its thread, so past maxWorkers there can be one per paused job
+    pthread_t workers[EXPORT_QUEUE_MAX_JOBS];
+    int workerCount;
+    int maxWorkers;           // Jobs that may run at once, paused ones don't count
+    int threadsPerJob;
+
+    // Slots never move, running exports write their progress straight into them
+    QueuedExport jobs[EXPORT_QUEUE_MAX_JOBS];
+    int nextId;
+    int batchFirstId;         // First job queued since the queue was last idle
+    double batchStartTime;
+} exportQueue = {0};
+
+
+static bool IsFinished(ExportJobState state) {
+    return state == EXPORT_JOB_DONE || state == EXPORT_JOB_FAILED || state == EXPORT_JOB_CANCELLED;
+}
+
+
+static QueuedExport* FindJob(int id) {
+    for (int i = 0; i < EXPORT_QUEUE_MAX_JOBS; i++) {
+        if (exportQueue.jobs[i].used && exportQueue.jobs[i].id == id) return &exportQueue.jobs[i];
+    }
+    return NULL;
+}
+
+
+// A cancelled export still writes to its output until it notices
+static bool IsOutputBusy(const char* outputPath) {
+    for (int i = 0; i < EXPORT_QUEUE_MAX_JOBS; i++) {
+        const QueuedExport* job = &exportQueue.jobs[i];
+        if (job->used && job->state == EXPORT_JOB_RUNNING && strcmp(job->outputPath, outputPath) == 0) return true;
+    }
+    return false;
+}
+
+
+// Oldest job that's waiting and not paused
+static QueuedExport* NextJob(void) {
+    QueuedExport* next = NULL;
+    for (int i = 0; i < EXPORT_QUEUE_MAX_JOBS; i++) {
+        QueuedExport* job = &exportQueue.jobs[i];
+        if (!job->used || job->state != EXPORT_JOB_QUEUED || job->pause || job->cancel) continue;
+        if (IsOutputBusy(job->outputPath)) continue;
+        if (next == NULL || job->id < next->id) next = job;
+    }
+    return next;
+}
+
+
+// Running and not paused
+static int CountActiveJobs(void) {
+    int active = 0;
+    for (int i = 0; i < EXPORT_QUEUE_MAX_JOBS; i++) {
+        const QueuedExport* job = &exportQueue.jobs[i];
+        if (job->used && job->state == EXPORT_JOB_RUNNING && !job->pause) active++;
+    }
+    return active;
+}
+
+
+static bool HasUnfinishedJobs(void) {
+    for (int i = 0; i < EXPORT_QUEUE_MAX_JOBS; i++) {
+        if (exportQueue.jobs[i].used && !IsFinished(exportQueue.jobs[i].state)) return true;
+    }
+    return false;
+}
+
+
+static void* ExportWorkerMain(void* arg);
+
+// Another worker if there's more waiting than there are idle workers, until there are as many as allowed.
+// Workers stuck on a paused job aren't counted against the limit, so pausing one doesn't stall the queue.
+static void StartWorkersIfNeeded(void) {
+    int running = 0;
+    int paused = 0;
+    int waiting = 0;
+    for (int i = 0; i < EXPORT_QUEUE_MAX_JOBS; i++) {
+        const QueuedExport* job = &exportQueue.jobs[i];
+        if (!job->used) continue;
+        if (job->state == EXPORT_JOB_RUNNING) {
+            running++;
+            if (job->pause) paused++;
+        } else if (job->state == EXPORT_JOB_QUEUED && !job->pause && !job->cancel) waiting++;
+    }
+
+    while (waiting > exportQueue.workerCount - running && exportQueue.workerCount - paused < exportQueue.maxWorkers &&
+           exportQueue.workerCount < EXPORT_QUEUE_MAX_JOBS) {
+        if (pthread_create(&exportQueue.workers[exportQueue.workerCount], NULL, ExportWorkerMain, NULL) != 0) {
+            if (exportQueue.workerCount == 0) TraceLog(LOG_WARNING, "Export: couldn't start an export thread");
+            break;
+        }
+        exportQueue.workerCount++;
+    }
+}
+
+
+static double GetJobEta(const QueuedExport* job, double now) {
+    if (job->state != EXPORT_JOB_RUNNING || job->progress < EXPORT_ETA_MIN_PROGRESS) return -1.0;
+    double paused = job->pausedTime + (job->pause ? now - job->pauseStart : 0.0);
+    double elapsed = now - job->startTime - paused;
+    return elapsed * (1.0 - job->progress) / job->progress;
+}
+
+
+static void* ExportWorkerMain(void* arg) {
+    // Exports can wait, the video on screen can't. Threads started from here (encoders, decoder) inherit it on Linux,
+    // the encoders ask for it themselves elsewhere.
+    LowerThreadPriority();
+
+    pthread_mutex_lock(&exportQueue.lock);
+    for (;;) {
+        // A job resumed while its replacement is running puts the queue over the limit until one of them finishes,
+        // nothing new starts before then
+        QueuedExport* job = NULL;
+        while (!exportQueue.stop && (CountActiveJobs() >= exportQueue.maxWorkers || (job = NextJob()) == NULL)) {
+            pthread_cond_wait(&exportQueue.wake, &exportQueue.lock);
+        }
+        if (exportQueue.stop) break;
+
+        job->state = EXPORT_JOB_RUNNING;
+        job->startTime = GetMonotonicTime();
+        // Copied so the export doesn't read the slot while the UI thread locks it
+        char inputPath[512];
+        char outputPath[512];
+        ExportOptions options = job->options;
+        snprintf(inputPath, sizeof(inputPath), "%s", job->inputPath);
+        snprintf(outputPath, sizeof(outputPath), "%s", job->outputPath);
+        pthread_mutex_unlock(&exportQueue.lock);
+
+        bool ok = ExportAnimation(inputPath, outputPath, &options);
+
+        pthread_mutex_lock(&exportQueue.lock);
+        if (job->cancel) job->state = EXPORT_JOB_CANCELLED;
+        else job->state = ok ? EXPORT_JOB_DONE : EXPORT_JOB_FAILED;
+        if (ok) job->progress = 1.0f;
+        job->pause = false;
+        // Room for a job another worker is waiting to start
+        pthread_cond_broadcast(&exportQueue.wake);
+    }
+    pthread_mutex_unlock(&exportQueue.lock);
+    return NULL;
+}
+
+
+void InitExportQueue(void) {
+    if (exportQueue.initialized) return;
+    pthread_mutex_init(&exportQueue.lock, NULL);
+    pthread_cond_init(&exportQueue.wake, NULL);
+    exportQueue.stop = false;
+    exportQueue.nextId = 1;
+
+    // Whatever isn't reserved is split between the workers, each export's encoder and decoder threads included
+    int spareCores = GetProcessorCount() - EXPORT_QUEUE_RESERVED_CORES;
+    if (spareCores < 1) spareCores = 1;
+    exportQueue.maxWorkers = (spareCores < EXPORT_QUEUE_MAX_WORKERS) ? spareCores : EXPORT_QUEUE_MAX_WORKERS;
+    exportQueue.threadsPerJob = spareCores / exportQueue.maxWorkers;
+    exportQueue.initialized = true;
+}
+
+
+void UnloadExportQueue(void) {
+    if (!exportQueue.initialized) return;
+
+    pthread_mutex_lock(&exportQueue.lock);
+    exportQueue.stop = true;
+    for (int i = 0; i < EXPORT_QUEUE_MAX_JOBS; i++) exportQueue.jobs[i].cancel = true;
+    pthread_cond_broadcast(&exportQueue.wake);
+    pthread_mutex_unlock(&exportQueue.lock);
+    for (int i = 0; i < exportQueue.workerCount; i++) pthread_join(exportQueue.workers[i], NULL);
+
+    pthread_cond_destroy(&exportQueue.wake);
+    pthread_mutex_destroy(&exportQueue.lock);
+    memset(&exportQueue, 0, sizeof(exportQueue));
+}
+
+
+int QueueExport(const char* inputPath, const char* outputPath, const ExportOptions* options) {
+    InitExportQueue();
+    pthread_mutex_lock(&exportQueue.lock);
+
+    // Two exports writing the same file would wreck each other's output, the one already on it wins.
+    // One that's been cancelled but hasn't stopped yet is waited for instead, see NextJob.
+    for (int i = 0; i < EXPORT_QUEUE_MAX_JOBS; i++) {
+        const QueuedExport* slot = &exportQueue.jobs[i];
+        if (slot->used && !IsFinished(slot->state) && !slot->cancel && strcmp(slot->outputPath, outputPath) == 0) {
+            int id = slot->id;
+            pthread_mutex_unlock(&exportQueue.lock);
+            TraceLog(LOG_INFO, "Export: %s is already being exported", outputPath);
+            return id;
+        }
+    }
+
+    // A free slot, or else the one the oldest finished job is in
+    QueuedExport* job = NULL;
+    for (int i = 0; i < EXPORT_QUEUE_MAX_JOBS; i++) {
+        QueuedExport* slot = &exportQueue.jobs[i];
+        if (!slot->used) {
+            job = slot;
+            break;
+        }
+        if (IsFinished(slot->state) && (job == NULL || slot->id < job->id)) job = slot;
+    }
+    if (job == NULL) {
+        pthread_mutex_unlock(&exportQueue.lock);
+        TraceLog(LOG_WARNING, "Export: queue is full, %s wasn't added", inputPath);
+        return -1;
+    }
+
+    // Nothing pending means this starts a new batch as far as overall progress goes
+    if (!HasUnfinishedJobs()) {
+        exportQueue.batchFirstId = exportQueue.nextId;
+        exportQueue.batchStartTime = GetMonotonicTime();
+    }
+
+    memset(job, 0, sizeof(*job));
+    job->used = true;
+    job->id = exportQueue.nextId++;
+    job->state = EXPORT_JOB_QUEUED;
+    snprintf(job->inputPath, sizeof(job->inputPath), "%s", inputPath);
+    snprintf(job->outputPath, sizeof(job->outputPath), "%s", outputPath);
+    job->options = *options;
+    job->options.threads = exportQueue.threadsPerJob;
+    job->options.background = true;
+    job->options.progress = &job->progress;
+    job->options.cancel = &job->cancel;
+    job->options.pause = &job->pause;
+
+    StartWorkersIfNeeded();
+
+    int id = job->id;
+    pthread_cond_signal(&exportQueue.wake);
+    pthread_mutex_unlock(&exportQueue.lock);
+    return id;
+}
+
+
+void CancelExport(int id) {
+    if (!exportQueue.initialized) return;
+    pthread_mutex_lock(&exportQueue.lock);
+    QueuedExport* job = FindJob(id);
+    if (job != NULL && !IsFinished(job->state)) {
+        job->cancel = true;
+        // Never started, nobody else is going to finish it off
+        if (job->state == EXPORT_JOB_QUEUED) job->state = EXPORT_JOB_CANCELLED;
+    }
+    pthread_mutex_unlock(&exportQueue.lock);
+}
+
+
+void PauseExport(int id, bool paused) {
+    if (!exportQueue.initialized) return;
+    pthread_mutex_lock(&exportQueue.lock);
+    QueuedExport* job = FindJob(id);
+    if (job != NULL && !IsFinished(job->state) && job->pause != paused) {
+        double now = GetMonotonicTime();
+        if (paused) job->pauseStart = now;
+        else if (job->state == EXPORT_JOB_RUNNING) job->pausedTime += now - job->pauseStart;
+        job->pause = paused;
+        // Either a waiting job that was skipped over may be next now, or a running one just gave up its turn
+        StartWorkersIfNeeded();
+        pthread_cond_broadcast(&exportQueue.wake);
+    }
+    pthread_mutex_unlock(&exportQueue.lock);
+}
+
+
+void ClearFinishedExports(void) {
+    if (!exportQueue.initialized) return;
+    pthread_mutex_lock(&exportQueue.lock);
+    for (int i = 0; i < EXPORT_QUEUE_MAX_JOBS; i++) {
+        if (exportQueue.jobs[i].used && IsFinished(exportQueue.jobs[i].state)) exportQueue.jobs[i].used = false;
+    }
+    pthread_mutex_unlock(&exportQueue.lock);
+}
+
+
+int GetExportJobs(ExportJobInfo* jobs, int maxJobs) {
+    if (!exportQueue.initialized) return 0;
+    pthread_mutex_lock(&exportQueue.lock);
+    double now = GetMonotonicTime();
+
+    // Ids only go up, so oldest first is picking the next smallest id each time
+    int count = 0;
+    int lastId = 0;
+    while (count < maxJobs) {
+        const QueuedExport* next = NULL;
+        for (int i = 0; i < EXPORT_QUEUE_MAX_JOBS; i++) {
+            const QueuedExport* job = &exportQueue.jobs[i];
+            if (job->used && job->id > lastId && (next == NULL || job->id < next->id)) next = job;
+        }
+        if (next == NULL) break;
+
+        ExportJobInfo* info = &jobs[count++];
+        info->id = next->id;
+        snprintf(info->inputPath, sizeof(info->inputPath), "%s", next->inputPath);
+        snprintf(info->outputPath, sizeof(info->outputPath), "%s", next->outputPath);
+        info->state = (next->pause && !IsFinished(next->state)) ? EXPORT_JOB_PAUSED : next->state;
+        info->progress = next->progress;
+        info->eta = GetJobEta(next, now);
+        lastId = next->id;
+    }
+
+    pthread_mutex_unlock(&exportQueue.lock);
+    return count;
+}
+
+
+bool IsExportQueueBusy(void) {
+    if (!exportQueue.initialized) return false;
+    pthread_mutex_lock(&exportQueue.lock);
+    bool busy = HasUnfinishedJobs();
+    pthread_mutex_unlock(&exportQueue.lock);
+    return busy;
+}
+
+
+float GetExportQueueProgress(double* eta) {
+    if (eta != NULL) *eta = -1.0;
+    if (!exportQueue.initialized) return 0.0f;
+    pthread_mutex_lock(&exportQueue.lock);
+
+    // Cancelled jobs don't count either way, everything else in the batch is an equal share
+    float total = 0.0f;
+    int count = 0;
+    for (int i = 0; i < EXPORT_QUEUE_MAX_JOBS; i++) {
+        const QueuedExport* job = &exportQueue.jobs[i];
+        if (!job->used || job->id < exportQueue.batchFirstId || job->state == EXPORT_JOB_CANCELLED) continue;
+        total += IsFinished(job->state) ? 1.0f : job->progress;
+        count++;
+    }
+    float progress = (count > 0) ? total / count : 0.0f;
+
+    // Jobs run side by side, so the batch's own rate says more than adding up per-job ETAs
+    if (eta != NULL && progress >= EXPORT_ETA_MIN_PROGRESS && progress < 1.0f) {
+        double elapsed = GetMonotonicTime() - exportQueue.batchStartTime;
+        *eta = elapsed * (1.0 - progress) / progress;
+    }
+
+    pthread_mutex_unlock(&exportQueue.lock);
+    return progress;
+}
@@ -0,0 +1,56 @@
+#ifndef EXPORTQUEUE_H
+#define EXPORTQUEUE_H
+
+#include "animexport.h"
+
+// Exports waiting their turn, run a few at a time on background threads so the explorer and playback keep going.
+// Export threads run below normal priority and the pool leaves a couple of cores alone,
+// whatever's left over for the UI thread and the playback decoder is what exports get.
+
+#define EXPORT_QUEUE_MAX_JOBS 64
+// Exports running at once, paused ones don't count
+#define EXPORT_QUEUE_MAX_WORKERS 2
+// Cores kept free for the UI thread and the video that's playing
+#define EXPORT_QUEUE_RESERVED_CORES 2
+
+typedef enum {
+    EXPORT_JOB_QUEUED,
+    EXPORT_JOB_RUNNING,
+    EXPORT_JOB_PAUSED,
+    EXPORT_JOB_DONE,
+    EXPORT_JOB_FAILED,
+    EXPORT_JOB_CANCELLED,
+} ExportJobState;
+
+typedef struct {
+    int id;
+    char inputPath[512];
+    char outputPath[512];
+    ExportJobState state;
+    float progress;  // 0 to 1
+    double eta;      // Seconds left, < 0 until there's enough progress to tell
+} ExportJobInfo;
+
+// Worker threads are only started once something is queued.
+void InitExportQueue(void);
+// Cancels whatever is queued or running and waits for the workers.
+void UnloadExportQueue(void);
+
+// Returns the job's id, or -1 if the queue is full of unfinished jobs.
+// If an unfinished job already writes to outputPath, that job's id is returned and nothing is queued.
+// threads, progress and cancel in options are the queue's to set, the rest is passed on as is.
+int QueueExport(const char* inputPath, const char* outputPath, const ExportOptions* options);
+void CancelExport(int id);
+// A running job stops between frames and holds on to its thread until it's resumed,
+// another worker starts in its place so the rest of the queue keeps going.
+void PauseExport(int id, bool paused);
+// Forgets finished, failed and cancelled jobs.
+void ClearFinishedExports(void);
+
+// Copies out every job the queue remembers, oldest first. Returns how many were copied.
+int GetExportJobs(ExportJobInfo* jobs, int maxJobs);
+bool IsExportQueueBusy(void);
+// Progress over everything queued since the queue was last idle, eta (optional) is seconds left, < 0 if unknown.
+float GetExportQueueProgress(double* eta);
+
+#endif
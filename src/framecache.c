@@ -0,0 +1,352 @@
+#include "framecache.h"
+#include "appmem.h"
+#include "ditherkernel.h"
+#include "videodecoder.h"
+#include "platform.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define FRAME_CACHE_VERSION 1
+
+// Written as is at the start of every cache file, followed by frameCount frames of (width/2)*height bytes
+typedef struct {
+    char magic[4];
+    int version;
+    int width;
+    int height;
+    int frameCount;
+    float frameRate;
+} FrameCacheHeader;
+
+struct FrameCache {
+    MappedFile file;
+    FrameCacheHeader header;
+    size_t frameBytes;
+};
+
+typedef struct {
+    char path[512];
+    long modTime;
+    long long size;
+} CacheEntry;
+
+static struct {
+    bool enabled;
+    char directory[512];
+    long long maxBytes;
+
+    pthread_t builder;
+    bool builderStarted;
+    atomic_bool cancel;
+    char buildPath[512];
+} frameCache = {0};
+
+// Something inside each level's range in dither.fs, so the shader lands on the same level again
+static const unsigned char levelValues[7] = {0, 32, 64, 128, 200, 225, 255};
+
+
+// Cache files are named after the video's path and modification time, so editing a video invalidates its cache.
+static void GetCacheFileName(const char* videoPath, const char* extension, char* fileName, size_t size) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (const char* c = videoPath; *c != '\0'; c++) hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+    long modTime = GetFileModTime(videoPath);
+    for (int i = 0; i < (int)sizeof(modTime); i++) hash = (hash ^ ((modTime >> (8*i)) & 0xff)) * 1099511628211ULL;
+
+    snprintf(fileName, size, "%s/%016llx%s", frameCache.directory, hash, extension);
+}
+
+
+static bool ReadCacheHeader(const char* fileName, FrameCacheHeader* header) {
+    FILE* file = fopen(fileName, "rb");
+    if (file == NULL) return false;
+    bool ok = fread(header, sizeof(*header), 1, file) == 1;
+    fclose(file);
+    return ok && memcmp(header->magic, "FFLC", 4) == 0 && header->version == FRAME_CACHE_VERSION;
+}
+
+
+static long long GetCacheBytes(const FrameCacheHeader* header) {
+    return sizeof(*header) + (long long)header->frameCount * (header->width / 2) * header->height;
+}
+
+
+static int CompareEntryAge(const void* a, const void* b) {
+    long x = ((const CacheEntry*)a)->modTime;
+    long y = ((const CacheEntry*)b)->modTime;
+    return (x > y) - (x < y);
+}
+
+
+static long long GetFrameCacheUsage(void) {
+    FilePathList files = LoadDirectoryFilesEx(frameCache.directory, ".ffc", false);
+    long long total = 0;
+    for (unsigned int i = 0; i < files.count; i++) {
+        bool isDirectory;
+        long long size, modTime;
+        if (GetFileInfo(files.paths[i], &isDirectory, &size, &modTime)) total += size;
+    }
+    UnloadDirectoryFiles(files);
+    return total;
+}
+
+
+// Deletes the least recently watched caches until incomingBytes more would fit.
+// Opening a cache touches its file, so modification time doubles as last use.
+static void TrimFrameCache(long long incomingBytes) {
+    FilePathList files = LoadDirectoryFilesEx(frameCache.directory, ".ffc", false);
+    CacheEntry* entries = (CacheEntry*)malloc(sizeof(CacheEntry) * (files.count + 1));
+    int count = 0;
+    long long total = 0;
+
+    for (unsigned int i = 0; i < files.count; i++) {
+        FrameCacheHeader header;
+        CacheEntry* entry = &entries[count];
+        snprintf(entry->path, sizeof(entry->path), "%s", files.paths[i]);
+        // Unreadable or outdated files count as the oldest, so they're the first to go
+        entry->modTime = ReadCacheHeader(entry->path, &header) ? GetFileModTime(entry->path) : 0;
+        entry->size = (entry->modTime != 0) ? GetCacheBytes(&header) : 0;
+        total += entry->size;
+        count++;
+    }
+    UnloadDirectoryFiles(files);
+
+    qsort(entries, count, sizeof(CacheEntry), CompareEntryAge);
+    for (int i = 0; i < count && (total + incomingBytes > frameCache.maxBytes || entries[i].modTime == 0); i++) {
+        // Fails on Windows while the file is mapped, which is fine, it's being watched
+        if (remove(entries[i].path) == 0) {
+            TraceLog(LOG_DEBUG, "Frame cache: evicted %s", entries[i].path);
+            total -= entries[i].size;
+        }
+    }
+
+    free(entries);
+}
+
+
+static void* BuildFrameCache(void* arg) {
+    (void)arg;
+    char partName[600], fileName[600];
+    GetCacheFileName(frameCache.buildPath, ".part", partName, sizeof(partName));
+    GetCacheFileName(frameCache.buildPath, ".ffc", fileName, sizeof(fileName));
+
+    VideoDecoder* decoder = OpenVideoDecoder(frameCache.buildPath, 0, 0, 0);
+    if (decoder == NULL) return NULL;
+
+    // Fit the display-size limit without upscaling, even width so two pixels always share a byte
+    int width = GetVideoDecoderWidth(decoder);
+    int height = GetVideoDecoderHeight(decoder);
+    float scale = fminf(1.0f, fminf((float)FRAME_CACHE_MAX_WIDTH / width, (float)FRAME_CACHE_MAX_HEIGHT / height));
+
+    // Long clips trade resolution for length. The dither pattern is drawn at screen resolution either way,
+    // a smaller cache only makes the areas of each level blockier.
+    float frameRate = (float)GetVideoDecoderFrameRate(decoder);
+    double frames = GetVideoDecoderDuration(decoder) * frameRate + 1;
+    double clipBytes = (double)frameCache.maxBytes / FRAME_CACHE_CLIP_SHARE;
+    double fullBytes = frames * (width * scale) * (height * scale) / 2;
+    if (fullBytes > clipBytes) scale *= (float)sqrt(clipBytes / fullBytes);
+    if (scale < fminf(1.0f, (float)FRAME_CACHE_MIN_HEIGHT / height)) {
+        TraceLog(LOG_INFO, "Frame cache: %s is too long to fit in the cache", frameCache.buildPath);
+        CloseVideoDecoder(decoder);
+        return NULL;
+    }
+
+    width = ((int)(width * scale) + 1) & ~1;
+    height = (int)(height * scale);
+    if (height < 1) height = 1;
+    SetVideoDecoderSize(decoder, width, height);
+
+    FrameCacheHeader header = {{'F', 'F', 'L', 'C'}, FRAME_CACHE_VERSION, width, height, 0, frameRate};
+    size_t frameBytes = (size_t)(width / 2) * height;
+    long long expectedBytes = sizeof(header) + (long long)frames * frameBytes;
+    TrimFrameCache(expectedBytes);
+
+    FILE* file = fopen(partName, "wb");
+    if (file == NULL) {
+        CloseVideoDecoder(decoder);
+        return NULL;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+
+    int chromaWidth = (width + 1) / 2;
+    int chromaHeight = (height + 1) / 2;
+    unsigned char* yuv = (unsigned char*)malloc((size_t)width * height + 2 * (size_t)chromaWidth * chromaHeight);
+    unsigned char* planes[3] = {yuv, yuv + (size_t)width * height, yuv + (size_t)width * height + (size_t)chromaWidth * chromaHeight};
+    int strides[3] = {width, chromaWidth, chromaWidth};
+    unsigned char* packed = (unsigned char*)malloc(frameBytes);
+
+    bool ok = true;
+    while (ok && !frameCache.cancel && DecodeVideoFrame(decoder, planes, strides, NULL)) {
+        for (int y = 0; y < height; y++) {
+            const unsigned char* luma = planes[0] + (size_t)y * strides[0];
+            const unsigned char* u = planes[1] + (size_t)(y / 2) * strides[1];
+            const unsigned char* v = planes[2] + (size_t)(y / 2) * strides[2];
+            unsigned char* out = packed + (size_t)y * (width / 2);
+            for (int x = 0; x < width; x += 2) {
+                // Both pixels of a pair share their chroma sample
+                int low = GetDitherLevel(GetYUVValue(luma[x], u[x / 2], v[x / 2]));
+                int high = GetDitherLevel(GetYUVValue(luma[x + 1], u[x / 2], v[x / 2]));
+                out[x / 2] = (unsigned char)(low | (high << 4));
+            }
+        }
+        ok = fwrite(packed, 1, frameBytes, file) == frameBytes;
+        header.frameCount++;
+    }
+
+    ok = ok && !frameCache.cancel && header.frameCount > 0;
+    if (ok) {
+        fseek(file, 0, SEEK_SET);
+        ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    }
+    ok = (fclose(file) == 0) && ok;
+
+    // Only finished caches ever carry the real name
+    if (ok) {
+        remove(fileName);
+        ok = rename(partName, fileName) == 0;
+    }
+    if (ok) TraceLog(LOG_INFO, "Frame cache: cached %s (%d frames at %dx%d)", frameCache.buildPath, header.frameCount, width, height);
+    else remove(partName);
+
+    free(packed);
+    free(yuv);
+    CloseVideoDecoder(decoder);
+    return NULL;
+}
+
+
+static void StopBuilder(void) {
+    if (!frameCache.builderStarted) return;
+    frameCache.cancel = true;
+    pthread_join(frameCache.builder, NULL);
+    frameCache.builderStarted = false;
+    frameCache.buildPath[0] = '\0';
+}
+
+
+void InitFrameCache(const char* directory, long long maxBytes) {
+    frameCache.enabled = false;
+    frameCache.maxBytes = maxBytes;
+    if (maxBytes <= 0 && maxBytes != FRAME_CACHE_AUTO) return;
+
+    snprintf(frameCache.directory, sizeof(frameCache.directory), "%s", directory);
+    if (DirectoryExists(frameCache.directory) || MakeDirectory(frameCache.directory) == 0) {
+        frameCache.enabled = true;
+
+        if (maxBytes == FRAME_CACHE_AUTO) {
+            // What's cached already could be freed up too, so it counts as room
+            long long freeBytes = GetFreeDiskSpace(frameCache.directory);
+            frameCache.maxBytes = FRAME_CACHE_DEFAULT_MAX_MB * 1024LL * 1024LL;
+            if (freeBytes > 0) {
+                long long autoBytes = (freeBytes + GetFrameCacheUsage()) / FRAME_CACHE_AUTO_SHARE;
+                if (autoBytes > frameCache.maxBytes) frameCache.maxBytes = autoBytes;
+            }
+            TraceLog(LOG_INFO, "Frame cache: using up to %lld MB", frameCache.maxBytes / (1024 * 1024));
+        }
+
+        // Leftovers from builds that never finished
+        FilePathList parts = LoadDirectoryFilesEx(frameCache.directory, ".part", false);
+        for (unsigned int i = 0; i < parts.count; i++) remove(parts.paths[i]);
+        UnloadDirectoryFiles(parts);
+
+        // The cap may have shrunk since last time
+        TrimFrameCache(0);
+    } else {
+        TraceLog(LOG_WARNING, "Frame cache directory %s not available, videos will always be decoded", directory);
+    }
+}
+
+
+void UnloadFrameCache(void) {
+    StopBuilder();
+}
+
+
+void RequestFrameCache(const char* videoPath) {
+    if (!frameCache.enabled || HasFrameCache(videoPath)) return;
+    if (frameCache.builderStarted && strcmp(frameCache.buildPath, videoPath) == 0) return;
+
+    StopBuilder();
+    snprintf(frameCache.buildPath, sizeof(frameCache.buildPath), "%s", videoPath);
+    frameCache.cancel = false;
+    if (pthread_create(&frameCache.builder, NULL, BuildFrameCache, NULL) == 0) frameCache.builderStarted = true;
+    else frameCache.buildPath[0] = '\0';
+}
+
+
+bool HasFrameCache(const char* videoPath) {
+    if (!frameCache.enabled) return false;
+    char fileName[600];
+    GetCacheFileName(videoPath, ".ffc", fileName, sizeof(fileName));
+    return FileExists(fileName);
+}
+
+
+FrameCache* OpenFrameCache(const char* videoPath) {
+    if (!frameCache.enabled) return NULL;
+    char fileName[600];
+    GetCacheFileName(videoPath, ".ffc", fileName, sizeof(fileName));
+
+    FrameCache* cache = (FrameCache*)AppAlloc(sizeof(FrameCache));
+    memset(cache, 0, sizeof(FrameCache));
+    if (!MapFileSequential(fileName, &cache->file)) {
+        AppFree(cache);
+        return NULL;
+    }
+
+    memcpy(&cache->header, cache->file.data, (cache->file.size >= (long long)sizeof(FrameCacheHeader)) ? sizeof(FrameCacheHeader) : 0);
+    cache->frameBytes = (size_t)(cache->header.width / 2) * cache->header.height;
+    if (memcmp(cache->header.magic, "FFLC", 4) != 0 || cache->header.version != FRAME_CACHE_VERSION ||
+        cache->header.frameCount <= 0 || cache->file.size < GetCacheBytes(&cache->header)) {
+        TraceLog(LOG_WARNING, "Frame cache: %s is damaged, ignoring it", fileName);
+        UnmapFile(&cache->file);
+        AppFree(cache);
+        remove(fileName);
+        return NULL;
+    }
+
+    TouchFile(fileName);
+    return cache;
+}
+
+
+void CloseFrameCache(FrameCache* cache) {
+    if (cache == NULL) return;
+    UnmapFile(&cache->file);
+    AppFree(cache);
+}
+
+
+int GetFrameCacheWidth(const FrameCache* cache) {
+    return cache->header.width;
+}
+
+
+int GetFrameCacheHeight(const FrameCache* cache) {
+    return cache->header.height;
+}
+
+
+int GetFrameCacheFrameCount(const FrameCache* cache) {
+    return cache->header.frameCount;
+}
+
+
+float GetFrameCacheFrameRate(const FrameCache* cache) {
+    return cache->header.frameRate;
+}
+
+
+void ExpandFrameCacheFrame(const FrameCache* cache, int index, unsigned char* pixels) {
+    if (index < 0) index = 0;
+    if (index >= cache->header.frameCount) index = cache->header.frameCount - 1;
+
+    const unsigned char* packed = cache->file.data + sizeof(FrameCacheHeader) + (size_t)index * cache->frameBytes;
+    for (size_t i = 0; i < cache->frameBytes; i++) {
+        pixels[2*i] = levelValues[packed[i] & 0x0f];
+        pixels[2*i + 1] = levelValues[packed[i] >> 4];
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include "raylib.h"
+
+// Videos boiled down to dither levels and kept on disk, so watching a clip again doesn't decode it again.
+// Colors aren't part of the cache, palettes are still applied by dither.fs, so switching them costs nothing.
+//
+// Each pixel is stored as its dither level (0-6) in 4 bits, at display size rather than source size.
+// A 4K clip cached at 1280x720 is ~450KB a frame instead of decoding 8M pixels a frame.
+
+#define FRAME_CACHE_DEFAULT_MAX_MB 2048
+// maxBytes for InitFrameCache: a quarter of what the cache could grow into on its disk, at least FRAME_CACHE_DEFAULT_MAX_MB
+#define FRAME_CACHE_AUTO -1
+#define FRAME_CACHE_AUTO_SHARE 4
+#define FRAME_CACHE_MAX_WIDTH 1280
+#define FRAME_CACHE_MAX_HEIGHT 720
+// Long clips are cached smaller so one of them takes at most 1/FRAME_CACHE_CLIP_SHARE of the cache,
+// but never below this height, past that they're not worth caching
+#define FRAME_CACHE_CLIP_SHARE 2
+#define FRAME_CACHE_MIN_HEIGHT 180
+
+typedef struct FrameCache FrameCache;
+
+// maxBytes is the total size the directory may grow to, least recently watched clips are deleted past it.
+// FRAME_CACHE_AUTO sizes it from the free disk space, anything else <= 0 disables the cache.
+void InitFrameCache(const char* directory, long long maxBytes);
+// Stops a build that's still running (the partial file is thrown away).
+void UnloadFrameCache(void);
+
+// Starts caching videoPath on a background thread, unless it's cached already.
+// A build for another file is cancelled, whatever's being watched now is what'll be rewatched.
+void RequestFrameCache(const char* videoPath);
+bool HasFrameCache(const char* videoPath);
+
+// Maps a finished cache, NULL if there isn't one. Main thread only, the handle counts as an app allocation.
+FrameCache* OpenFrameCache(const char* videoPath);
+void CloseFrameCache(FrameCache* cache);
+
+int GetFrameCacheWidth(const FrameCache* cache);
+int GetFrameCacheHeight(const FrameCache* cache);
+int GetFrameCacheFrameCount(const FrameCache* cache);
+float GetFrameCacheFrameRate(const FrameCache* cache);
+
+// Unpacks a frame into width*height grayscale pixels that dither.fs turns back into the same levels.
+void ExpandFrameCacheFrame(const FrameCache* cache, int index, unsigned char* pixels);
+
+#endif
@@ -0,0 +1,308 @@
+#include "headless.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    EVENT_MOVE,
+    EVENT_CLICK,
+    EVENT_SCROLL,
+    EVENT_RESIZE,
+    EVENT_DUMP,
+    EVENT_END,
+} ScriptEventType;
+
+typedef struct {
+    int frame;
+    ScriptEventType type;
+    float x;
+    float y;
+} ScriptEvent;
+
+typedef struct {
+    const char* label;
+    float updateMs;
+    float renderMs;
+    float dumpMs;
+} FrameCost;
+
+static struct {
+    bool active;
+    float frameTime;
+    int frame;  // -1 until the first UpdateHeadless
+
+    ScriptEvent* events;
+    int eventCount;
+    int nextEvent;
+    int endFrame;
+
+    // What the current frame sees
+    Vector2 mouse;
+    Vector2 mouseScale;
+    bool clicked;
+    float wheel;
+    bool resized;
+    bool dumpRequested;
+    int screenWidth;
+    int screenHeight;
+
+    FrameCost* costs;
+    int costCount;
+    int costCapacity;
+} headless = {0};
+
+
+float GetAppFrameTime(void) {
+    return headless.active ? headless.frameTime : GetFrameTime();
+}
+
+
+double GetAppTime(void) {
+    return headless.active ? headless.frame * (double)headless.frameTime : GetTime();
+}
+
+
+Vector2 GetAppMousePosition(void) {
+    if (!headless.active) return GetMousePosition();
+    return (Vector2){headless.mouse.x * headless.mouseScale.x, headless.mouse.y * headless.mouseScale.y};
+}
+
+
+bool IsAppMouseButtonPressed(int button) {
+    if (!headless.active) return IsMouseButtonPressed(button);
+    return headless.clicked && button == MOUSE_BUTTON_LEFT;
+}
+
+
+float GetAppMouseWheelMove(void) {
+    return headless.active ? headless.wheel : GetMouseWheelMove();
+}
+
+
+bool IsAppWindowResized(void) {
+    return headless.active ? headless.resized : IsWindowResized();
+}
+
+
+int GetAppScreenWidth(void) {
+    return headless.active ? headless.screenWidth : GetScreenWidth();
+}
+
+
+int GetAppScreenHeight(void) {
+    return headless.active ? headless.screenHeight : GetScreenHeight();
+}
+
+
+void SetAppMouseScale(float scaleX, float scaleY) {
+    headless.mouseScale = (Vector2){scaleX, scaleY};
+    SetMouseScale(scaleX, scaleY);
+}
+
+
+bool IsHeadless(void) {
+    return headless.active;
+}
+
+
+static bool ParseScriptLine(const char* line, ScriptEvent* event) {
+    char command[16];
+    int read = 0;
+    if (sscanf(line, "%d %15s%n", &event->frame, command, &read) != 2 || event->frame < 0) return false;
+
+    const char* args = line + read;
+    event->x = event->y = 0;
+    if (strcmp(command, "move") == 0) event->type = EVENT_MOVE;
+    else if (strcmp(command, "click") == 0) event->type = EVENT_CLICK;
+    else if (strcmp(command, "resize") == 0) event->type = EVENT_RESIZE;
+    else if (strcmp(command, "scroll") == 0) {
+        event->type = EVENT_SCROLL;
+        return sscanf(args, "%f", &event->x) == 1;
+    }
+    else if (strcmp(command, "dump") == 0) {
+        event->type = EVENT_DUMP;
+        return true;
+    }
+    else if (strcmp(command, "end") == 0) {
+        event->type = EVENT_END;
+        return true;
+    }
+    else return false;
+
+    return sscanf(args, "%f %f", &event->x, &event->y) == 2;
+}
+
+
+bool BeginHeadless(const char* scriptFileName, float frameTime, int screenWidth, int screenHeight) {
+    char* text = LoadFileText(scriptFileName);
+    if (text == NULL) return false;
+
+    int capacity = 64;
+    headless.events = (ScriptEvent*)malloc(sizeof(ScriptEvent) * capacity);
+    headless.eventCount = 0;
+
+    int lineNumber = 0;
+    bool ok = true;
+    for (char* line = text; line != NULL && ok; ) {
+        char* next = strchr(line, '\n');
+        if (next != NULL) *next++ = '\0';
+        lineNumber++;
+
+        char* comment = strchr(line, '#');
+        if (comment != NULL) *comment = '\0';
+        if (strspn(line, " \t\r") == strlen(line)) {
+            line = next;
+            continue;
+        }
+
+        ScriptEvent event;
+        if (!ParseScriptLine(line, &event)) {
+            TraceLog(LOG_WARNING, "Headless: %s:%d: can't make sense of \"%s\"", scriptFileName, lineNumber, line);
+            ok = false;
+        } else if (headless.eventCount > 0 && event.frame < headless.events[headless.eventCount - 1].frame) {
+            TraceLog(LOG_WARNING, "Headless: %s:%d: frame %d comes after frame %d", scriptFileName, lineNumber,
+                     event.frame, headless.events[headless.eventCount - 1].frame);
+            ok = false;
+        } else {
+            if (headless.eventCount == capacity) {
+                capacity *= 2;
+                headless.events = (ScriptEvent*)realloc(headless.events, sizeof(ScriptEvent) * capacity);
+            }
+            headless.events[headless.eventCount++] = event;
+        }
+        line = next;
+    }
+    UnloadFileText(text);
+
+    if (!ok) {
+        free(headless.events);
+        headless.events = NULL;
+        return false;
+    }
+
+    // Without an explicit end, give the last event a second to play out
+    int lastFrame = (headless.eventCount > 0) ? headless.events[headless.eventCount - 1].frame : 0;
+    headless.endFrame = lastFrame + (int)(1.0f / frameTime + 0.5f);
+
+    headless.active = true;
+    headless.frameTime = frameTime;
+    headless.frame = -1;
+    headless.nextEvent = 0;
+    headless.mouse = (Vector2){-1, -1};
+    headless.mouseScale = (Vector2){1, 1};
+    headless.screenWidth = screenWidth;
+    headless.screenHeight = screenHeight;
+    headless.costCount = 0;
+
+    return true;
+}
+
+
+bool UpdateHeadless(void) {
+    headless.frame++;
+    headless.clicked = false;
+    headless.wheel = 0;
+    headless.resized = false;
+    headless.dumpRequested = false;
+
+    while (headless.nextEvent < headless.eventCount && headless.events[headless.nextEvent].frame == headless.frame) {
+        ScriptEvent* event = &headless.events[headless.nextEvent++];
+        switch (event->type) {
+            case EVENT_CLICK:
+                headless.clicked = true;
+                // Fall through, a click also moves the mouse there
+            case EVENT_MOVE:
+                headless.mouse = (Vector2){event->x, event->y};
+                break;
+            case EVENT_SCROLL:
+                headless.wheel += event->x;
+                break;
+            case EVENT_RESIZE:
+                headless.screenWidth = (int)event->x;
+                headless.screenHeight = (int)event->y;
+                headless.resized = true;
+                break;
+            case EVENT_DUMP:
+                headless.dumpRequested = true;
+                break;
+            case EVENT_END:
+                headless.endFrame = headless.frame;
+                break;
+        }
+    }
+
+    return headless.frame < headless.endFrame;
+}
+
+
+int GetHeadlessFrame(void) {
+    return headless.frame;
+}
+
+
+bool IsHeadlessDumpRequested(void) {
+    return headless.dumpRequested;
+}
+
+
+void RecordHeadlessFrame(const char* label, double updateMs, double renderMs, double dumpMs) {
+    if (headless.costCount == headless.costCapacity) {
+        headless.costCapacity = (headless.costCapacity > 0) ? headless.costCapacity * 2 : 1024;
+        headless.costs = (FrameCost*)realloc(headless.costs, sizeof(FrameCost) * headless.costCapacity);
+    }
+    headless.costs[headless.costCount++] = (FrameCost){label, (float)updateMs, (float)renderMs, (float)dumpMs};
+}
+
+
+static int CompareFloats(const void* a, const void* b) {
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+
+// Logs mean, 95th percentile and worst update + render cost for one label.
+static void LogFrameCostSummary(const char* label, float* scratch) {
+    int count = 0;
+    double total = 0;
+    for (int i = 0; i < headless.costCount; i++) {
+        if (strcmp(headless.costs[i].label, label) != 0) continue;
+        scratch[count] = headless.costs[i].updateMs + headless.costs[i].renderMs;
+        total += scratch[count++];
+    }
+    qsort(scratch, count, sizeof(float), CompareFloats);
+
+    TraceLog(LOG_INFO, "Headless: %-12s %5d frames, mean %.3fms, p95 %.3fms, max %.3fms", label, count,
+             total / count, scratch[(int)(count * 0.95f) < count ? (int)(count * 0.95f) : count - 1], scratch[count - 1]);
+}
+
+
+void EndHeadless(const char* csvFileName) {
+    FILE* file = fopen(csvFileName, "w");
+    if (file != NULL) {
+        fprintf(file, "frame,time,screen,update_ms,render_ms,dump_ms\n");
+        for (int i = 0; i < headless.costCount; i++) {
+            FrameCost* cost = &headless.costs[i];
+            fprintf(file, "%d,%.4f,%s,%.4f,%.4f,%.4f\n", i, i * headless.frameTime, cost->label, cost->updateMs, cost->renderMs, cost->dumpMs);
+        }
+        fclose(file);
+    } else {
+        TraceLog(LOG_WARNING, "Headless: couldn't write %s", csvFileName);
+    }
+
+    // One summary line per label, in the order they first showed up
+    float* scratch = (float*)malloc(sizeof(float) * (headless.costCount + 1));
+    for (int i = 0; i < headless.costCount; i++) {
+        bool seen = false;
+        for (int j = 0; j < i && !seen; j++) seen = strcmp(headless.costs[j].label, headless.costs[i].label) == 0;
+        if (!seen) LogFrameCostSummary(headless.costs[i].label, scratch);
+    }
+    free(scratch);
+
+    free(headless.events);
+    free(headless.costs);
+    headless.events = NULL;
+    headless.costs = NULL;
+    headless.costCount = headless.costCapacity = 0;
+    headless.active = false;
+}
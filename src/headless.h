@@ -0,0 +1,43 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "raylib.h"
+
+// Time, input and screen size as the app sees them.
+// Normally these go straight to raylib. In a headless run they come from a fixed clock and an input script,
+// so the same script always renders the same frames no matter how fast the machine is.
+//
+// Scripts are one event per line, "<frame> <command> [args]", frames in order, # starts a comment:
+//   0 resize 1920 1080    window size in pixels
+//   30 move 640 400       mouse position in window pixels
+//   31 click 640 400      move, then a left click on that frame
+//   90 scroll -3          mouse wheel
+//   120 dump              save this frame even if --dump-every wouldn't
+//   600 end               stop (otherwise the run stops 1 second after the last event)
+
+float GetAppFrameTime(void);
+double GetAppTime(void);
+Vector2 GetAppMousePosition(void);
+bool IsAppMouseButtonPressed(int button);
+float GetAppMouseWheelMove(void);
+bool IsAppWindowResized(void);
+int GetAppScreenWidth(void);
+int GetAppScreenHeight(void);
+void SetAppMouseScale(float scaleX, float scaleY);
+
+bool IsHeadless(void);
+
+// Switches to the virtual clock and input. Returns false if the script can't be read.
+bool BeginHeadless(const char* scriptFileName, float frameTime, int screenWidth, int screenHeight);
+// Applies the script events for the next frame. Returns false once the script is over.
+bool UpdateHeadless(void);
+int GetHeadlessFrame(void);
+// True if the current frame was asked for with a dump event.
+bool IsHeadlessDumpRequested(void);
+
+// Frame costs in milliseconds, label is what was on screen (must stay valid until EndHeadless).
+void RecordHeadlessFrame(const char* label, double updateMs, double renderMs, double dumpMs);
+// Writes every recorded frame to csvFileName, logs a per-label summary and frees the script.
+void EndHeadless(const char* csvFileName);
+
+#endif
@@ -0,0 +1,781 @@
+#include "libraryindex.h"
+#include "platform.h"
+#include "videodecoder.h"
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LIBRARY_INDEX_VERSION 1
+#define LIBRARY_MAX_DEPTH 32      // Symlinked folders can loop forever otherwise
+#define LIBRARY_MAX_TERMS 8
+#define LIBRARY_POLL_INTERVAL 0.25
+
+typedef struct {
+    int path;          // Offset into strings
+    int parent;        // -1 for roots
+    long long modTime;
+    int firstFile;     // A folder's files are next to each other, sorted by name
+    int fileCount;
+} LibraryDir;
+
+typedef struct {
+    int name;          // Offset into strings, the full path is the folder's path + "/" + name
+    int dir;
+    long long size;
+    long long modTime;
+    float duration;
+    short width;
+    short height;
+} LibraryFile;
+
+// Never changes once published, the indexer builds a new one and swaps it in
+typedef struct {
+    LibraryDir* dirs;
+    LibraryFile* files;
+    char* strings;
+    char* folded;      // strings in lowercase, for searching
+    int dirCount;
+    int fileCount;
+    int stringBytes;
+} LibrarySnapshot;
+
+// On disk this is followed by the dirs, files and strings arrays as they are in memory
+typedef struct {
+    char magic[4];
+    int version;
+    int dirCount;
+    int fileCount;
+    int stringBytes;
+} LibraryIndexHeader;
+
+typedef struct {
+    char* name;
+    long long size;
+    long long modTime;
+    float duration;
+    short width;
+    short height;
+} ScanFile;
+
+typedef struct {
+    char* path;
+    int parent;
+    int depth;
+    bool exists;
+    long long modTime;
+    ScanFile* files;
+    int fileCount;
+} ScanDir;
+
+static struct {
+    char indexFileName[512];
+    char excludePath[512];  // Our own cache folder, it changes all the time and never holds videos
+    char roots[LIBRARY_MAX_ROOTS][512];
+    int rootCount;
+
+    pthread_t thread;
+    bool started;
+    atomic_bool stop;
+    atomic_bool indexing;
+
+    pthread_mutex_t lock;  // Guards current and version
+    LibrarySnapshot* current;
+    int version;
+
+    // Scan state, shared by the indexer thread and its workers under scanLock.
+    // scanDirs doubles as the queue, everything past scanNext is still waiting to be read.
+    pthread_mutex_t scanLock;
+    pthread_cond_t scanCond;
+    ScanDir* scanDirs;
+    int scanCount;
+    int scanCapacity;
+    int scanNext;
+    int scanBusy;
+
+    // What the last scan found, read-only while scanning
+    const LibrarySnapshot* previous;
+    int* previousSlots;    // Hash of folder paths, index + 1, 0 is empty
+    unsigned int previousMask;
+    int* previousFirstChild;
+    int* previousNextSibling;
+
+    int* probeList;
+    int probeCount;
+    int probeNext;
+} library = {0};
+
+
+static unsigned int HashPath(const char* path) {
+    unsigned int hash = 2166136261u;
+    for (const char* c = path; *c != '\0'; c++) hash = (hash ^ (unsigned char)*c) * 16777619u;
+    return hash;
+}
+
+
+static char FoldChar(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+
+// IsFileExtension goes through TextToLower's static buffer, which the scan threads can't share
+static bool IsVideoFileName(const char* name) {
+    static const char* extensions[] = {".mov", ".mp4", ".mkv", ".avi"};
+    const char* dot = strrchr(name, '.');
+    if (dot == NULL) return false;
+
+    for (int i = 0; i < (int)(sizeof(extensions) / sizeof(extensions[0])); i++) {
+        const char* a = dot;
+        const char* b = extensions[i];
+        while (*a != '\0' && FoldChar(*a) == *b) a++, b++;
+        if (*a == '\0' && *b == '\0') return true;
+    }
+    return false;
+}
+
+
+static void FreeSnapshot(LibrarySnapshot* snapshot) {
+    if (snapshot == NULL) return;
+    free(snapshot->dirs);
+    free(snapshot->files);
+    free(snapshot->strings);
+    free(snapshot->folded);
+    free(snapshot);
+}
+
+
+static void FoldSnapshotStrings(LibrarySnapshot* snapshot) {
+    snapshot->folded = (char*)malloc(snapshot->stringBytes + 1);
+    for (int i = 0; i < snapshot->stringBytes; i++) snapshot->folded[i] = FoldChar(snapshot->strings[i]);
+}
+
+
+static void GetLibraryFilePath(const LibrarySnapshot* snapshot, int index, char* path, size_t size) {
+    const LibraryFile* file = &snapshot->files[index];
+    snprintf(path, size, "%s/%s", snapshot->strings + snapshot->dirs[file->dir].path, snapshot->strings + file->name);
+}
+
+
+static void PublishSnapshot(LibrarySnapshot* snapshot) {
+    pthread_mutex_lock(&library.lock);
+    LibrarySnapshot* old = library.current;
+    library.current = snapshot;
+    library.version++;
+    pthread_mutex_unlock(&library.lock);
+
+    // Only the indexer thread publishes, so nothing else can still be scanning the old one
+    if (old != library.previous) FreeSnapshot(old);
+}
+
+
+static bool SnapshotsEqual(const LibrarySnapshot* a, const LibrarySnapshot* b) {
+    if (a == NULL || b == NULL) return false;
+    return a->dirCount == b->dirCount && a->fileCount == b->fileCount && a->stringBytes == b->stringBytes &&
+           memcmp(a->dirs, b->dirs, sizeof(LibraryDir) * a->dirCount) == 0 &&
+           memcmp(a->files, b->files, sizeof(LibraryFile) * a->fileCount) == 0 &&
+           memcmp(a->strings, b->strings, a->stringBytes) == 0;
+}
+
+
+static LibrarySnapshot* LoadLibraryFile(void) {
+    FILE* file = fopen(library.indexFileName, "rb");
+    if (file == NULL) return NULL;
+
+    LibraryIndexHeader header;
+    LibrarySnapshot* snapshot = (LibrarySnapshot*)calloc(1, sizeof(LibrarySnapshot));
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "FFLI", 4) == 0 &&
+              header.version == LIBRARY_INDEX_VERSION && header.dirCount >= 0 && header.fileCount >= 0 && header.stringBytes > 0;
+    if (ok) {
+        snapshot->dirCount = header.dirCount;
+        snapshot->fileCount = header.fileCount;
+        snapshot->stringBytes = header.stringBytes;
+        snapshot->dirs = (LibraryDir*)malloc(sizeof(LibraryDir) * (header.dirCount + 1));
+        snapshot->files = (LibraryFile*)malloc(sizeof(LibraryFile) * (header.fileCount + 1));
+        snapshot->strings = (char*)malloc(header.stringBytes + 1);
+        ok = fread(snapshot->dirs, sizeof(LibraryDir), header.dirCount, file) == (size_t)header.dirCount &&
+             fread(snapshot->files, sizeof(LibraryFile), header.fileCount, file) == (size_t)header.fileCount &&
+             fread(snapshot->strings, 1, header.stringBytes, file) == (size_t)header.stringBytes &&
+             snapshot->strings[header.stringBytes - 1] == '\0';
+    }
+    fclose(file);
+
+    // Everything that points somewhere has to point inside the file
+    for (int i = 0; ok && i < snapshot->dirCount; i++) {
+        LibraryDir* dir = &snapshot->dirs[i];
+        ok = dir->path >= 0 && dir->path < snapshot->stringBytes && dir->parent < i && dir->firstFile >= 0 &&
+             dir->fileCount >= 0 && dir->firstFile + dir->fileCount <= snapshot->fileCount;
+    }
+    for (int i = 0; ok && i < snapshot->fileCount; i++) {
+        LibraryFile* entry = &snapshot->files[i];
+        ok = entry->name >= 0 && entry->name < snapshot->stringBytes && entry->dir >= 0 && entry->dir < snapshot->dirCount;
+    }
+
+    if (!ok) {
+        TraceLog(LOG_WARNING, "Library: %s is damaged, indexing from scratch", library.indexFileName);
+        FreeSnapshot(snapshot);
+        return NULL;
+    }
+
+    FoldSnapshotStrings(snapshot);
+    return snapshot;
+}
+
+
+static void SaveLibraryFile(const LibrarySnapshot* snapshot) {
+    char partName[600];
+    snprintf(partName, sizeof(partName), "%s.part", library.indexFileName);
+    FILE* file = fopen(partName, "wb");
+    if (file == NULL) {
+        TraceLog(LOG_WARNING, "Library: couldn't write %s", partName);
+        return;
+    }
+
+    LibraryIndexHeader header = {{'F', 'F', 'L', 'I'}, LIBRARY_INDEX_VERSION, snapshot->dirCount, snapshot->fileCount, snapshot->stringBytes};
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(snapshot->dirs, sizeof(LibraryDir), snapshot->dirCount, file) == (size_t)snapshot->dirCount &&
+              fwrite(snapshot->files, sizeof(LibraryFile), snapshot->fileCount, file) == (size_t)snapshot->fileCount &&
+              fwrite(snapshot->strings, 1, snapshot->stringBytes, file) == (size_t)snapshot->stringBytes;
+    ok = (fclose(file) == 0) && ok;
+
+    if (ok) {
+        remove(library.indexFileName);
+        ok = rename(partName, library.indexFileName) == 0;
+    }
+    if (!ok) remove(partName);
+}
+
+
+// Lookups into what the last scan found, so unchanged folders don't have to be read again.
+static void IndexPreviousSnapshot(const LibrarySnapshot* snapshot) {
+    library.previous = snapshot;
+    if (snapshot == NULL) return;
+
+    unsigned int slotCount = 16;
+    while (slotCount < (unsigned int)snapshot->dirCount * 2) slotCount *= 2;
+    library.previousMask = slotCount - 1;
+    library.previousSlots = (int*)calloc(slotCount, sizeof(int));
+    library.previousFirstChild = (int*)malloc(sizeof(int) * (snapshot->dirCount + 1));
+    library.previousNextSibling = (int*)malloc(sizeof(int) * (snapshot->dirCount + 1));
+
+    for (int i = 0; i < snapshot->dirCount; i++) library.previousFirstChild[i] = -1;
+    for (int i = snapshot->dirCount - 1; i >= 0; i--) {
+        unsigned int slot = HashPath(snapshot->strings + snapshot->dirs[i].path) & library.previousMask;
+        while (library.previousSlots[slot] != 0) slot = (slot + 1) & library.previousMask;
+        library.previousSlots[slot] = i + 1;
+
+        int parent = snapshot->dirs[i].parent;
+        library.previousNextSibling[i] = (parent >= 0) ? library.previousFirstChild[parent] : -1;
+        if (parent >= 0) library.previousFirstChild[parent] = i;
+    }
+}
+
+
+static int FindPreviousDir(const char* path) {
+    const LibrarySnapshot* snapshot = library.previous;
+    if (snapshot == NULL) return -1;
+
+    unsigned int slot = HashPath(path) & library.previousMask;
+    while (library.previousSlots[slot] != 0) {
+        int index = library.previousSlots[slot] - 1;
+        if (strcmp(snapshot->strings + snapshot->dirs[index].path, path) == 0) return index;
+        slot = (slot + 1) & library.previousMask;
+    }
+    return -1;
+}
+
+
+static int FindPreviousFile(int dirIndex, const char* name) {
+    const LibrarySnapshot* snapshot = library.previous;
+    const LibraryDir* dir = &snapshot->dirs[dirIndex];
+    int low = dir->firstFile;
+    int high = dir->firstFile + dir->fileCount - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        int order = strcmp(snapshot->strings + snapshot->files[middle].name, name);
+        if (order == 0) return middle;
+        if (order < 0) low = middle + 1;
+        else high = middle - 1;
+    }
+    return -1;
+}
+
+
+static void ForgetPreviousSnapshot(void) {
+    free(library.previousSlots);
+    free(library.previousFirstChild);
+    free(library.previousNextSibling);
+    library.previousSlots = library.previousFirstChild = library.previousNextSibling = NULL;
+    library.previous = NULL;
+}
+
+
+// Caller holds scanLock
+static void QueueScanDir(char* path, int parent, int depth) {
+    if (library.scanCount == library.scanCapacity) {
+        library.scanCapacity = (library.scanCapacity > 0) ? library.scanCapacity * 2 : 1024;
+        library.scanDirs = (ScanDir*)realloc(library.scanDirs, sizeof(ScanDir) * library.scanCapacity);
+    }
+    library.scanDirs[library.scanCount++] = (ScanDir){path, parent, depth, false, 0, NULL, 0};
+}
+
+
+typedef struct {
+    ScanFile* files;
+    int fileCount;
+    int fileCapacity;
+    char** children;
+    int childCount;
+    int childCapacity;
+} ScanListing;
+
+
+static void AddListingFile(ScanListing* listing, ScanFile file) {
+    if (listing->fileCount == listing->fileCapacity) {
+        listing->fileCapacity = (listing->fileCapacity > 0) ? listing->fileCapacity * 2 : 16;
+        listing->files = (ScanFile*)realloc(listing->files, sizeof(ScanFile) * listing->fileCapacity);
+    }
+    listing->files[listing->fileCount++] = file;
+}
+
+
+static void AddListingChild(ScanListing* listing, char* path) {
+    if (listing->childCount == listing->childCapacity) {
+        listing->childCapacity = (listing->childCapacity > 0) ? listing->childCapacity * 2 : 16;
+        listing->children = (char**)realloc(listing->children, sizeof(char*) * listing->childCapacity);
+    }
+    listing->children[listing->childCount++] = path;
+}
+
+
+// Lists one folder. Returns false if it's gone.
+static bool ReadScanDir(const char* path, int depth, long long* modTime, ScanListing* listing) {
+    bool isDirectory;
+    long long size;
+    if (!GetFileInfo(path, &isDirectory, &size, modTime) || !isDirectory) return false;
+
+    // A folder's modification time moves whenever something in it is added, removed or renamed,
+    // so if it hasn't, last scan's names are still right. Writing to a file doesn't touch the folder though,
+    // so each file is still checked and probed again if it changed.
+    const LibrarySnapshot* previous = library.previous;
+    int old = FindPreviousDir(path);
+    if (old >= 0 && previous->dirs[old].modTime == *modTime) {
+        const LibraryDir* dir = &previous->dirs[old];
+        for (int i = dir->firstFile; i < dir->firstFile + dir->fileCount && !library.stop; i++) {
+            const LibraryFile* file = &previous->files[i];
+            char fullPath[1024];
+            long long fileSize, fileModTime;
+            snprintf(fullPath, sizeof(fullPath), "%s/%s", path, previous->strings + file->name);
+            if (!GetFileInfo(fullPath, &isDirectory, &fileSize, &fileModTime) || isDirectory) continue;
+
+            ScanFile scanFile = {strdup(previous->strings + file->name), fileSize, fileModTime, -1.0f, 0, 0};
+            if (file->size == fileSize && file->modTime == fileModTime) {
+                scanFile.duration = file->duration;
+                scanFile.width = file->width;
+                scanFile.height = file->height;
+            }
+            AddListingFile(listing, scanFile);
+        }
+        for (int child = library.previousFirstChild[old]; child >= 0; child = library.previousNextSibling[child]) {
+            AddListingChild(listing, strdup(previous->strings + previous->dirs[child].path));
+        }
+        return true;
+    }
+
+    // Times are whole seconds, something added later in the second the folder last changed in wouldn't move it.
+    // A listing read in that same second is kept without a time, so the next scan reads the folder again.
+    long long listedTime = (long long)time(NULL);
+    if (*modTime >= listedTime) *modTime = 0;
+
+    DIR* handle = opendir(path);
+    if (handle == NULL) return true;
+
+    struct dirent* entry;
+    while ((entry = readdir(handle)) != NULL && !library.stop) {
+        const char* name = entry->d_name;
+        // Hidden folders are things like .git and .Trash, nobody keeps videos there
+        if (name[0] == '.') continue;
+
+        bool isVideo = IsVideoFileName(name);
+#if defined(_DIRENT_HAVE_D_TYPE)
+        // Where readdir already knows the type, most files never need a stat
+        if (!isVideo && entry->d_type != DT_DIR && entry->d_type != DT_LNK && entry->d_type != DT_UNKNOWN) continue;
+#endif
+
+        char fullPath[1024];
+        long long fileSize, fileModTime;
+        snprintf(fullPath, sizeof(fullPath), "%s/%s", path, name);
+        if (!GetFileInfo(fullPath, &isDirectory, &fileSize, &fileModTime)) continue;
+
+        if (isDirectory) {
+            if (depth < LIBRARY_MAX_DEPTH && strcmp(fullPath, library.excludePath) != 0) AddListingChild(listing, strdup(fullPath));
+        } else if (isVideo) {
+            ScanFile file = {strdup(name), fileSize, fileModTime, -1.0f, 0, 0};
+            // Same size and time as last scan, the probe results still hold
+            int oldFile = (old >= 0) ? FindPreviousFile(old, name) : -1;
+            if (oldFile >= 0 && previous->files[oldFile].size == fileSize && previous->files[oldFile].modTime == fileModTime) {
+                file.duration = previous->files[oldFile].duration;
+                file.width = previous->files[oldFile].width;
+                file.height = previous->files[oldFile].height;
+            }
+            AddListingFile(listing, file);
+        }
+    }
+    closedir(handle);
+
+    return true;
+}
+
+
+static void* ScanWorkerMain(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&library.scanLock);
+    for (;;) {
+        // Nothing queued but someone's still reading a folder, which may queue more
+        while (library.scanNext == library.scanCount && library.scanBusy > 0 && !library.stop) {
+            pthread_cond_wait(&library.scanCond, &library.scanLock);
+        }
+        if (library.scanNext == library.scanCount || library.stop) break;
+
+        int index = library.scanNext++;
+        const char* path = library.scanDirs[index].path;
+        int depth = library.scanDirs[index].depth;
+        library.scanBusy++;
+        pthread_mutex_unlock(&library.scanLock);
+
+        ScanListing listing = {0};
+        long long modTime = 0;
+        bool exists = ReadScanDir(path, depth, &modTime, &listing);
+
+        pthread_mutex_lock(&library.scanLock);
+        ScanDir* dir = &library.scanDirs[index];
+        dir->exists = exists;
+        dir->modTime = modTime;
+        dir->files = listing.files;
+        dir->fileCount = listing.fileCount;
+        for (int i = 0; i < listing.childCount; i++) QueueScanDir(listing.children[i], index, depth + 1);
+        free(listing.children);
+        library.scanBusy--;
+        pthread_cond_broadcast(&library.scanCond);
+    }
+    pthread_cond_broadcast(&library.scanCond);
+    pthread_mutex_unlock(&library.scanLock);
+    return NULL;
+}
+
+
+static int CompareScanFiles(const void* a, const void* b) {
+    return strcmp(((const ScanFile*)a)->name, ((const ScanFile*)b)->name);
+}
+
+
+static int AddString(LibrarySnapshot* snapshot, const char* text) {
+    int offset = snapshot->stringBytes;
+    int length = (int)strlen(text) + 1;
+    memcpy(snapshot->strings + offset, text, length);
+    snapshot->stringBytes += length;
+    return offset;
+}
+
+
+// Lays the scan results out as a snapshot. Parents are always queued before their children,
+// so a folder whose parent is gone is dropped in the same pass.
+static LibrarySnapshot* BuildSnapshot(void) {
+    int* dirIndex = (int*)malloc(sizeof(int) * (library.scanCount + 1));
+    long long stringBytes = 0;
+    int fileCount = 0;
+    for (int i = 0; i < library.scanCount; i++) {
+        ScanDir* dir = &library.scanDirs[i];
+        stringBytes += strlen(dir->path) + 1;
+        for (int j = 0; j < dir->fileCount; j++) stringBytes += strlen(dir->files[j].name) + 1;
+        fileCount += dir->fileCount;
+    }
+
+    LibrarySnapshot* snapshot = (LibrarySnapshot*)calloc(1, sizeof(LibrarySnapshot));
+    snapshot->dirs = (LibraryDir*)malloc(sizeof(LibraryDir) * (library.scanCount + 1));
+    snapshot->files = (LibraryFile*)malloc(sizeof(LibraryFile) * (fileCount + 1));
+    snapshot->strings = (char*)malloc(stringBytes + 1);
+
+    for (int i = 0; i < library.scanCount; i++) {
+        ScanDir* scan = &library.scanDirs[i];
+        int parent = (scan->parent >= 0) ? dirIndex[scan->parent] : -1;
+        dirIndex[i] = -1;
+        if (!scan->exists || (scan->parent >= 0 && parent < 0)) continue;
+
+        if (scan->fileCount > 1) qsort(scan->files, scan->fileCount, sizeof(ScanFile), CompareScanFiles);
+        dirIndex[i] = snapshot->dirCount;
+        snapshot->dirs[snapshot->dirCount++] = (LibraryDir){AddString(snapshot, scan->path), parent, scan->modTime, snapshot->fileCount, scan->fileCount};
+        for (int j = 0; j < scan->fileCount; j++) {
+            ScanFile* file = &scan->files[j];
+            snapshot->files[snapshot->fileCount++] = (LibraryFile){AddString(snapshot, file->name), dirIndex[i], file->size, file->modTime,
+                                                                   file->duration, file->width, file->height};
+        }
+    }
+
+    free(dirIndex);
+    FoldSnapshotStrings(snapshot);
+    return snapshot;
+}
+
+
+static void FreeScan(void) {
+    for (int i = 0; i < library.scanCount; i++) {
+        ScanDir* dir = &library.scanDirs[i];
+        for (int j = 0; j < dir->fileCount; j++) free(dir->files[j].name);
+        free(dir->files);
+        free(dir->path);
+    }
+    free(library.scanDirs);
+    library.scanDirs = NULL;
+    library.scanCount = library.scanCapacity = library.scanNext = library.scanBusy = 0;
+}
+
+
+static void* ProbeWorkerMain(void* arg) {
+    LibrarySnapshot* snapshot = (LibrarySnapshot*)arg;
+    for (;;) {
+        pthread_mutex_lock(&library.scanLock);
+        int index = (library.probeNext < library.probeCount && !library.stop) ? library.probeList[library.probeNext++] : -1;
+        pthread_mutex_unlock(&library.scanLock);
+        if (index < 0) break;
+
+        // Each worker has its own files, nobody else is looking at this snapshot until it's published
+        char path[1024];
+        int width = 0, height = 0;
+        double duration = 0;
+        GetLibraryFilePath(snapshot, index, path, sizeof(path));
+        LibraryFile* file = &snapshot->files[index];
+        if (ProbeVideoFile(path, &width, &height, &duration)) {
+            file->duration = (float)duration;
+            file->width = (short)width;
+            file->height = (short)height;
+        } else {
+            file->duration = 0;
+        }
+    }
+    return NULL;
+}
+
+
+static void RunWorkers(void* (*main)(void*), void* arg) {
+    pthread_t workers[LIBRARY_SCAN_THREADS];
+    int started = 0;
+    for (int i = 0; i < LIBRARY_SCAN_THREADS; i++) {
+        if (pthread_create(&workers[started], NULL, main, arg) == 0) started++;
+    }
+    // Couldn't get any threads, do it here
+    if (started == 0) main(arg);
+    for (int i = 0; i < started; i++) pthread_join(workers[i], NULL);
+}
+
+
+// Walks every root, publishes what it found, then probes whatever's new and publishes again.
+static void ScanLibrary(DirectoryWatch* watch) {
+    pthread_mutex_lock(&library.lock);
+    IndexPreviousSnapshot(library.current);
+    pthread_mutex_unlock(&library.lock);
+
+    for (int i = 0; i < library.rootCount; i++) QueueScanDir(strdup(library.roots[i]), -1, 0);
+    RunWorkers(ScanWorkerMain, NULL);
+    if (library.stop) {
+        FreeScan();
+        ForgetPreviousSnapshot();
+        return;
+    }
+
+    LibrarySnapshot* snapshot = BuildSnapshot();
+    FreeScan();
+    for (int i = 0; i < snapshot->dirCount; i++) {
+        if (snapshot->dirs[i].parent >= 0) AddDirectoryWatch(watch, snapshot->strings + snapshot->dirs[i].path, false);
+    }
+
+    // Nothing changed, which is what most rescans find (and saving would just trigger another one)
+    LibrarySnapshot* previous = (LibrarySnapshot*)library.previous;
+    if (SnapshotsEqual(snapshot, previous)) {
+        FreeSnapshot(snapshot);
+        snapshot = previous;
+    } else {
+        PublishSnapshot(snapshot);
+    }
+    ForgetPreviousSnapshot();
+    if (previous != snapshot) FreeSnapshot(previous);
+
+    library.probeCount = library.probeNext = 0;
+    library.probeList = (int*)malloc(sizeof(int) * (snapshot->fileCount + 1));
+    for (int i = 0; i < snapshot->fileCount; i++) {
+        if (snapshot->files[i].duration < 0) library.probeList[library.probeCount++] = i;
+    }
+
+    if (library.probeCount > 0) {
+        TraceLog(LOG_INFO, "Library: %d files indexed, probing %d new ones", snapshot->fileCount, library.probeCount);
+
+        // Probing takes a while over a network, search keeps using the unprobed snapshot meanwhile
+        LibrarySnapshot* probed = (LibrarySnapshot*)calloc(1, sizeof(LibrarySnapshot));
+        *probed = *snapshot;
+        probed->dirs = (LibraryDir*)malloc(sizeof(LibraryDir) * (snapshot->dirCount + 1));
+        probed->files = (LibraryFile*)malloc(sizeof(LibraryFile) * (snapshot->fileCount + 1));
+        probed->strings = (char*)malloc(snapshot->stringBytes + 1);
+        memcpy(probed->dirs, snapshot->dirs, sizeof(LibraryDir) * snapshot->dirCount);
+        memcpy(probed->files, snapshot->files, sizeof(LibraryFile) * snapshot->fileCount);
+        memcpy(probed->strings, snapshot->strings, snapshot->stringBytes);
+        FoldSnapshotStrings(probed);
+
+        RunWorkers(ProbeWorkerMain, probed);
+        // Cut short or not, whatever got probed is kept, the rest is picked up next time
+        PublishSnapshot(probed);
+        snapshot = probed;
+    }
+    free(library.probeList);
+    library.probeList = NULL;
+
+    if (snapshot != previous || library.probeCount > 0) SaveLibraryFile(snapshot);
+}
+
+
+static void* IndexerMain(void* arg) {
+    (void)arg;
+    LibrarySnapshot* saved = LoadLibraryFile();
+    if (saved != NULL) PublishSnapshot(saved);
+
+    DirectoryWatch* watch = OpenDirectoryWatch();
+    for (int i = 0; i < library.rootCount; i++) AddDirectoryWatch(watch, library.roots[i], true);
+
+    while (!library.stop) {
+        library.indexing = true;
+        ScanLibrary(watch);
+        library.indexing = false;
+
+        double changedAt = -1;
+        while (!library.stop) {
+            SleepSeconds(LIBRARY_POLL_INTERVAL);
+            double now = GetMonotonicTime();
+            if (PollDirectoryWatch(watch)) changedAt = now;
+            if (changedAt >= 0 && now - changedAt >= LIBRARY_RESCAN_SETTLE) break;
+        }
+    }
+
+    CloseDirectoryWatch(watch);
+    return NULL;
+}
+
+
+void InitLibraryIndex(const char* indexFileName, const char* const* roots, int rootCount) {
+    snprintf(library.indexFileName, sizeof(library.indexFileName), "%s", indexFileName);
+    snprintf(library.excludePath, sizeof(library.excludePath), "%s", GetDirectoryPath(indexFileName));
+    MakeDirectory(library.excludePath);
+
+    library.rootCount = 0;
+    for (int i = 0; i < rootCount && library.rootCount < LIBRARY_MAX_ROOTS; i++) {
+        char* root = library.roots[library.rootCount];
+        snprintf(root, sizeof(library.roots[0]), "%s", roots[i]);
+        // Trailing separators would end up doubled in every path below
+        size_t length = strlen(root);
+        while (length > 1 && (root[length - 1] == '/' || root[length - 1] == '\\')) root[--length] = '\0';
+        library.rootCount++;
+    }
+
+    pthread_mutex_init(&library.lock, NULL);
+    pthread_mutex_init(&library.scanLock, NULL);
+    pthread_cond_init(&library.scanCond, NULL);
+    library.stop = false;
+    library.started = pthread_create(&library.thread, NULL, IndexerMain, NULL) == 0;
+    if (!library.started) TraceLog(LOG_WARNING, "Library: couldn't start the indexer, search is off");
+}
+
+
+void UnloadLibraryIndex(void) {
+    if (!library.started) return;
+    library.stop = true;
+    pthread_mutex_lock(&library.scanLock);
+    pthread_cond_broadcast(&library.scanCond);
+    pthread_mutex_unlock(&library.scanLock);
+    pthread_join(library.thread, NULL);
+    library.started = false;
+
+    FreeSnapshot(library.current);
+    library.current = NULL;
+    pthread_mutex_destroy(&library.lock);
+    pthread_mutex_destroy(&library.scanLock);
+    pthread_cond_destroy(&library.scanCond);
+}
+
+
+bool IsLibraryIndexing(void) {
+    return library.indexing;
+}
+
+
+int GetLibraryFileCount(void) {
+    if (!library.started) return 0;
+    pthread_mutex_lock(&library.lock);
+    int count = (library.current != NULL) ? library.current->fileCount : 0;
+    pthread_mutex_unlock(&library.lock);
+    return count;
+}
+
+
+int GetLibraryVersion(void) {
+    if (!library.started) return 0;
+    pthread_mutex_lock(&library.lock);
+    int version = library.version;
+    pthread_mutex_unlock(&library.lock);
+    return version;
+}
+
+
+int SearchLibrary(const char* query, LibraryResult* results, int maxResults) {
+    // Split into lowercase terms
+    char terms[LIBRARY_MAX_TERMS][64];
+    int termCount = 0;
+    for (const char* c = query; *c != '\0' && termCount < LIBRARY_MAX_TERMS; ) {
+        while (*c == ' ' || *c == '\t') c++;
+        int length = 0;
+        while (*c != '\0' && *c != ' ' && *c != '\t') {
+            if (length < (int)sizeof(terms[0]) - 1) terms[termCount][length++] = FoldChar(*c);
+            c++;
+        }
+        terms[termCount][length] = '\0';
+        if (length > 0) termCount++;
+    }
+    if (termCount == 0 || !library.started) return 0;
+
+    pthread_mutex_lock(&library.lock);
+    const LibrarySnapshot* snapshot = library.current;
+    int matches = 0;
+    if (snapshot != NULL) {
+        // Terms found in a folder's path hold for all of its files, so only the names are searched per file
+        unsigned char* dirTerms = (unsigned char*)malloc(snapshot->dirCount + 1);
+        for (int i = 0; i < snapshot->dirCount; i++) {
+            dirTerms[i] = 0;
+            for (int t = 0; t < termCount; t++) {
+                if (strstr(snapshot->folded + snapshot->dirs[i].path, terms[t]) != NULL) dirTerms[i] |= 1 << t;
+            }
+        }
+
+        unsigned char allTerms = (unsigned char)((1 << termCount) - 1);
+        for (int i = 0; i < snapshot->fileCount; i++) {
+            const LibraryFile* file = &snapshot->files[i];
+            unsigned char found = dirTerms[file->dir];
+            for (int t = 0; t < termCount && found != allTerms; t++) {
+                if (!(found & (1 << t)) && strstr(snapshot->folded + file->name, terms[t]) != NULL) found |= 1 << t;
+            }
+            if (found != allTerms) continue;
+
+            if (matches < maxResults) {
+                LibraryResult* result = &results[matches];
+                GetLibraryFilePath(snapshot, i, result->path, sizeof(result->path));
+                result->size = file->size;
+                result->duration = file->duration;
+                result->width = file->width;
+                result->height = file->height;
+            }
+            matches++;
+        }
+        free(dirTerms);
+    }
+    pthread_mutex_unlock(&library.lock);
+
+    return matches;
+}
@@ -0,0 +1,40 @@
+#ifndef LIBRARYINDEX_H
+#define LIBRARYINDEX_H
+
+#include "raylib.h"
+
+// Every video under a set of root folders, indexed in the background and kept on disk between runs,
+// so searching a share with hundreds of thousands of files is instant instead of a directory walk.
+//
+// Folders are walked by several threads at once. Rescans only read folders whose modification time changed,
+// and they're kicked off by change notifications (inotify, or FindFirstChangeNotification on Windows).
+// New or changed files are probed for their duration and size afterwards, the index is searchable before that.
+
+#define LIBRARY_MAX_ROOTS 16
+#define LIBRARY_SCAN_THREADS 8
+// Seconds of quiet after a change before rescanning, copying a folder of clips is a lot of changes
+#define LIBRARY_RESCAN_SETTLE 2.0
+
+typedef struct {
+    char path[512];
+    long long size;
+    float duration;  // Seconds, < 0 until it's been probed, 0 if probing failed
+    int width;
+    int height;
+} LibraryResult;
+
+// Loads the index saved at indexFileName (if any) and starts indexing roots in the background.
+void InitLibraryIndex(const char* indexFileName, const char* const* roots, int rootCount);
+// Stops the indexer, whatever was found so far is already saved.
+void UnloadLibraryIndex(void);
+
+bool IsLibraryIndexing(void);
+int GetLibraryFileCount(void);
+// Goes up every time the indexer publishes a new index, so callers know to search again.
+int GetLibraryVersion(void);
+
+// Every whitespace separated term has to appear in the file's path, case doesn't matter.
+// Returns how many files matched, the first maxResults of them are copied into results.
+int SearchLibrary(const char* query, LibraryResult* results, int maxResults);
+
+#endif
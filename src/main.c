@@ -1,5 +1,17 @@
 #include "raylib.h"
 #include "raymedia.h"
+#include "shaderprogram.h"
+#include "shadermanager.h"
+#include "targetpool.h"
+#include "mediapool.h"
+#include "pipemode.h"
+#include "animexport.h"
+#include "exportqueue.h"
+#include "headless.h"
+#include "framecache.h"
+#include "syncclock.h"
+#include "libraryindex.h"
+#include "appmem.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -7,6 +19,26 @@
 #include <math.h>
 
 #define CIRCLE_COUNT 40
+// Size of the disc texture every background circle is drawn from, big enough that the largest circle isn't blurry.
+#define CIRCLE_TEXTURE_SIZE 512
+
+// Seconds a window size has to hold still before the render targets are shrunk to fit it.
+#define RESIZE_SETTLE_TIME 0.25f
+
+// Fixed seed for headless runs, so the background is the same every time.
+#define HEADLESS_RANDOM_SEED 1337
+
+// Most search results the explorer lists at once.
+#define SEARCH_MAX_RESULTS 500
+
+// Pixel scale: the UI and video are rendered at window size / scale and blown back up with nearest-neighbor.
+// Auto picks the biggest scale that still leaves a 1280x720 layout, manual scales never go below 640x360.
+#define PIXEL_SCALE_AUTO 0
+#define PIXEL_SCALE_MAX 3
+
+// Palette grid: room under each cell for the palette's name, and space between cells.
+#define PALETTE_GRID_LABEL_HEIGHT 24
+#define PALETTE_GRID_GAP 10
 
 #ifndef _DEBUG
 
@@ -14,6 +46,25 @@
 
 #endif
 
+// Uniforms of dither.fs, in the order they're handed to LoadShaderProgram.
+typedef enum {
+    DITHER_LIGHT_COLOR,
+    DITHER_DARK_COLOR,
+    DITHER_PATTERN_ORIGIN,
+    DITHER_UNIFORM_COUNT
+} DitherUniform;
+
+static const ShaderUniformDesc ditherUniforms[DITHER_UNIFORM_COUNT] = {
+    {"lightColor", SHADER_UNIFORM_VEC4},
+    {"darkColor", SHADER_UNIFORM_VEC4},
+    {"patternOrigin", SHADER_UNIFORM_VEC2},
+};
+
+// palette.fs only takes its color table, and that's bound as a texture every frame.
+static const ShaderUniformDesc paletteUniforms[] = {
+    {"paletteColors", SHADER_UNIFORM_SAMPLER2D},
+};
+
 // Screen states
 typedef enum {
     SCREEN_PALETTES,
@@ -37,10 +88,10 @@ typedef enum {
     FILE_TYPE_BACK
 } FileType;
 
-// File entry
+// File entry, name and path live in state.fileStrings until the list is reloaded
 typedef struct {
-    char name[256];
-    char path[512];
+    const char* name;
+    const char* path;
     FileType type;
     bool selected;
 } FileEntry;
@@ -75,6 +126,19 @@ typedef struct {
     float opacity;
 } BackgroundCircle;
 
+// Every palette side by side on the view screen.
+// The frame is dithered once into maskTarget at cell size (in black and white),
+// then palette.fs colors that one mask for every cell.
+typedef struct {
+    bool enabled;
+    int columns;
+    int rows;
+    int cellWidth;
+    int cellHeight;
+    Rectangle area;
+    RenderTexture2D maskTarget;
+} PaletteGrid;
+
 // Global state
 typedef struct {
     ScreenState currentScreen;
@@ -95,17 +159,30 @@ typedef struct {
     // Background
     BackgroundCircle circles[CIRCLE_COUNT];
     int circleCount;
+    // One white disc, every circle is a quad of it so the whole field goes out in a single batch
+    Texture2D circleTexture;
     float circleOpacityTimer;
 
     // Shaders
-    // ditherShader is the backbone.
-    // invertShader is for when the colors are flipped for dark mode.
+    // ditherProgram is the backbone, dither.fs is compiled once and shared by the UI and the video.
+    // uiUniforms gets its colors flipped for dark mode, videoUniforms never does.
     // We don't want the video to play with an ugly inverted color scheme.
-    Shader ditherShader;
-    Shader videoShader;
-
+    ShaderProgram ditherProgram;
+    ShaderUniformBlock uiUniforms;
+    ShaderUniformBlock videoUniforms;
+    // The palette grid's mask pass, dither.fs in plain black and white.
+    ShaderUniformBlock maskUniforms;
+    ShaderProgram paletteProgram;
+    // colorCount x 2, light colors on top and dark colors below
+    Texture2D paletteTexture;
+    PaletteGrid paletteGrid;
+
+    // These come from the render target pool and are usually a bit bigger than the window.
+    // uiTarget holds the dithered UI at layout size, only needed when it's scaled up afterwards.
     RenderTexture2D renderTarget;
     RenderTexture2D videoTarget;
+    RenderTexture2D uiTarget;
+    float resizeSettleTimer;
     Palette* colorPalettes;
     int colorCount;
     int colorIndex;
@@ -117,29 +194,70 @@ typedef struct {
     Sprites sprites;
 
     // Explorer
+    // files only ever grows and fileStrings keeps its blocks, so reloading a list doesn't allocate
     FileEntry* files;
     int fileCount;
+    int fileCapacity;
+    StringPool fileStrings;
     char currentPath[512];
     char pathInput[512];
     int selectedFileIndex;
     float scrollOffset;
     float targetScrollOffset;
 
+    // Library search, while searchQuery isn't empty the file list shows matches from every indexed folder
+    const char* libraryRoots[LIBRARY_MAX_ROOTS];
+    int libraryRootCount;
+    char searchQuery[128];
+    bool searchFocused;
+    int searchVersion;
+    int searchMatches;
+    LibraryResult* searchResults;
+
     // Video
+    // video points into the media pool, recently viewed and highlighted files stay open there.
     char selectedVideoPath[512];
-    MediaStream video;
+    MediaStream* video;
     bool videoLoaded;
+    // Set when the picture comes from the frame cache, video is then an audio-only session that keeps the time.
+    // Clips without audio have no session at all, the sync clock alone moves cachedPosition along.
+    FrameCache* frameCache;
+    Texture2D frameCacheTexture;
+    unsigned char* frameCachePixels;
+    int frameCacheFrame;
+    int frameCacheMB;
+    double cachedPosition;
+    bool cachedPlaying;
     Rectangle videoDisplayRect;
     bool looping;
     bool muted;
+    // Decides how far the media moves each frame, F3 shows its stats and F4 switches policy.
+    SyncClock syncClock;
+    SyncPolicy syncPolicy;
+    bool showSyncStats;
+    // Frames drawn since the video was opened, the first ones are still setting things up
+    int playbackFrames;
 
     // Rendering
+    // Exports go through the export queue. renderProgress and renderEta cover everything it's working on,
+    // exportJobs is the queue as it was at the start of the frame.
     bool isRendering;
     float renderProgress;
+    double renderEta;
+    ExportJobInfo exportJobs[EXPORT_QUEUE_MAX_JOBS];
+    int exportJobCount;
+    int viewExportId;  // The job the view screen's export button started
 
     // Window
+    // windowWidth/windowHeight are the layout size everything is drawn at, i.e. the real window size / pixelScale.
     int windowWidth;
     int windowHeight;
+    int pixelScaleSetting;
+    int pixelScale;
+    bool pixelScaleChanged;  // Set from the palettes screen mid-draw, applied next UpdateApp
+
+    // Headless runs draw the final frame here instead of to the window, at the virtual screen size.
+    RenderTexture2D screenTarget;
 } AppState;
 
 AppState state = {0};
@@ -172,7 +290,7 @@ void InitPalettes() {
     // New Palette can go here.
 
     state.colorCount = 5; // Edit this number based on amount of palettes above.
-    state.colorPalettes = (Palette*)MemAlloc(sizeof(Palette) * state.colorCount);
+    state.colorPalettes = (Palette*)AppAlloc(sizeof(Palette) * state.colorCount);
 
     state.colorPalettes[0] = barePalette;
     state.colorPalettes[1] = gbPalette;
@@ -184,6 +302,14 @@ void InitPalettes() {
 
 
 void InitBackgroundCircles() {
+    // Drawn once on the CPU, mipmaps keep the small circles from shimmering
+    Image disc = GenImageColor(CIRCLE_TEXTURE_SIZE, CIRCLE_TEXTURE_SIZE, BLANK);
+    ImageDrawCircle(&disc, CIRCLE_TEXTURE_SIZE / 2, CIRCLE_TEXTURE_SIZE / 2, CIRCLE_TEXTURE_SIZE / 2 - 1, WHITE);
+    state.circleTexture = LoadTextureFromImage(disc);
+    UnloadImage(disc);
+    GenTextureMipmaps(&state.circleTexture);
+    SetTextureFilter(state.circleTexture, TEXTURE_FILTER_TRILINEAR);
+
     state.circleCount = CIRCLE_COUNT;
     for (int i = 0; i < state.circleCount; i++) {
         state.circles[i].basePos = (Vector2){
@@ -197,47 +323,50 @@ void InitBackgroundCircles() {
 }
 
 
-void LoadDirectory(const char* path) {
-    // Free previous files
-    if (state.files != NULL) {
-        free(state.files);
-        state.files = NULL;
+// Makes room for count entries in the file list and forgets the old ones.
+void ResetFileList(int count) {
+    if (count > state.fileCapacity) {
+        state.fileCapacity = (count > 2 * state.fileCapacity) ? count : 2 * state.fileCapacity;
+        state.files = (FileEntry*)AppRealloc(state.files, sizeof(FileEntry) * state.fileCapacity);
     }
+    ResetStringPool(&state.fileStrings);
     state.fileCount = 0;
     state.selectedFileIndex = -1;
+    state.scrollOffset = 0;
+    state.targetScrollOffset = 0;
+}
 
-    strcpy(state.currentPath, path);
-    strcat(state.currentPath, "\0");
-    strcpy(state.pathInput, state.currentPath);
+
+void AddFileEntry(const char* name, const char* path, FileType type) {
+    state.files[state.fileCount++] = (FileEntry){PoolString(&state.fileStrings, name), PoolString(&state.fileStrings, path), type, false};
+}
+
+
+void LoadDirectory(const char* path) {
+    // path usually comes out of the file list, which is about to be reused, so it's copied first
+    if (path != state.currentPath) CopyString(state.currentPath, sizeof(state.currentPath), path);
+    CopyString(state.pathInput, sizeof(state.pathInput), state.currentPath);
 
     FilePathList filePathList = LoadDirectoryFiles(state.currentPath);
 
     char* filePath;
+    int count = 0;
     for (int i = 0; i < filePathList.count; i++) {
         filePath = filePathList.paths[i];
         if (DirectoryExists(filePath) || IsFileExtension(filePath, ".mov") || IsFileExtension(filePath, ".mp4") ||
                 IsFileExtension(filePath, ".mkv") || IsFileExtension(filePath, ".avi")) {
-            state.fileCount++;
+            count++;
         }
     }
 
-    state.files = (FileEntry*)MemAlloc(sizeof(FileEntry) * (state.fileCount + 1));
-
-    strcpy(state.files[0].name, "Navigate to parent directory..\0");
-    strcpy(state.files[0].path, GetPrevDirectoryPath(state.currentPath));
-    state.files[0].selected = false;
-    state.files[0].type = FILE_TYPE_BACK;
-    int fileIndex = 1;
-
+    ResetFileList(count + 1);
+    AddFileEntry("Navigate to parent directory..", GetPrevDirectoryPath(state.currentPath), FILE_TYPE_BACK);
 
     // Import directories first before implementing standalone files (so directories and files aren't intermixed).
     for (int i = 0; i < filePathList.count; i++) {
         filePath = filePathList.paths[i];
         if (DirectoryExists(filePath)) {
-            strcpy(state.files[fileIndex].name, GetFileName(filePath));
-            strcpy(state.files[fileIndex].path, filePath);
-            state.files[fileIndex].type = FILE_TYPE_FOLDER;
-            state.files[fileIndex++].selected = false;
+            AddFileEntry(GetFileName(filePath), filePath, FILE_TYPE_FOLDER);
         }
     }
 
@@ -246,18 +375,31 @@ void LoadDirectory(const char* path) {
         filePath = filePathList.paths[i];
         if (IsFileExtension(filePath, ".mov") || IsFileExtension(filePath, ".mp4") ||
             IsFileExtension(filePath, ".mkv") || IsFileExtension(filePath, ".avi")) {
-            strcpy(state.files[fileIndex].name, GetFileName(filePath));
-            strcpy(state.files[fileIndex].path, filePath);
-            state.files[fileIndex].type = FILE_TYPE_VIDEO;
-            state.files[fileIndex++].selected = false;
+            AddFileEntry(GetFileName(filePath), filePath, FILE_TYPE_VIDEO);
         }
     }
 
-    state.fileCount = fileIndex;
     UnloadDirectoryFiles(filePathList);
+}
 
-    state.scrollOffset = 0;
-    state.targetScrollOffset = 0;
+
+// Fills the file list with library matches for state.searchQuery, the current folder stays as it was.
+void LoadSearchResults() {
+    if (state.searchResults == NULL) state.searchResults = (LibraryResult*)AppAlloc(sizeof(LibraryResult) * SEARCH_MAX_RESULTS);
+    state.searchMatches = SearchLibrary(state.searchQuery, state.searchResults, SEARCH_MAX_RESULTS);
+    state.searchVersion = GetLibraryVersion();
+    int count = (state.searchMatches < SEARCH_MAX_RESULTS) ? state.searchMatches : SEARCH_MAX_RESULTS;
+
+    ResetFileList(count);
+    for (int i = 0; i < count; i++) {
+        LibraryResult* result = &state.searchResults[i];
+        const char* name = GetFileName(result->path);
+        if (result->duration > 0) {
+            int seconds = (int)result->duration;
+            name = FrameTextFormat("%s  (%d:%02d, %dx%d)", name, seconds / 60, seconds % 60, result->width, result->height);
+        }
+        AddFileEntry(name, result->path, FILE_TYPE_VIDEO);
+    }
 }
 
 
@@ -275,8 +417,10 @@ void TransitionToScreen(ScreenState screen) {
 }
 
 
+// The circles only ever move by their parallax offset, so they're all the same texture at different places and sizes.
+// Textured quads share a batch where DrawCircle would build a triangle fan per circle.
 void DrawBackgroundCircles(float fadeAlpha) {
-    Vector2 mousePos = GetMousePosition();
+    Vector2 mousePos = GetAppMousePosition();
     Vector2 mouseDelta = {
             (mousePos.x - state.windowWidth / 2) * 0.02f,
             (mousePos.y - state.windowHeight / 2) * 0.02f
@@ -292,12 +436,14 @@ void DrawBackgroundCircles(float fadeAlpha) {
 
         // Use gray color for circles with combined opacity
         Color circleColor = (Color){0, 0, 0, (unsigned char)(state.circles[i].opacity * fadeAlpha * 255)};
-        DrawCircle((int)pos.x, (int)pos.y, state.circles[i].radius, circleColor);
+        float radius = state.circles[i].radius;
+        DrawTexturePro(state.circleTexture, (Rectangle){0, 0, CIRCLE_TEXTURE_SIZE, CIRCLE_TEXTURE_SIZE},
+                       (Rectangle){(int)pos.x - radius, (int)pos.y - radius, 2 * radius, 2 * radius}, (Vector2){0, 0}, 0, circleColor);
     }
 }
 
 bool DrawButton(Rectangle bounds, const char* text, float* hoverScale, float alpha) {
-    Vector2 mousePos = GetMousePosition();
+    Vector2 mousePos = GetAppMousePosition();
     bool isHovered = CheckCollisionPointRec(mousePos, bounds);
     bool isClicked = false;
 
@@ -332,7 +478,7 @@ bool DrawButton(Rectangle bounds, const char* text, float* hoverScale, float alp
 
 
 
-        if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+        if (IsAppMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
             isClicked = true;
         }
     } else {
@@ -374,7 +520,7 @@ bool DrawButton(Rectangle bounds, const char* text, float* hoverScale, float alp
 }
 
 bool DrawSpriteButton(Rectangle bounds, Sprite icon, float* hoverScale, float alpha) {
-    Vector2 mousePos = GetMousePosition();
+    Vector2 mousePos = GetAppMousePosition();
     bool isHovered = CheckCollisionPointRec(mousePos, bounds);
     bool isClicked = false;
 
@@ -408,7 +554,7 @@ bool DrawSpriteButton(Rectangle bounds, Sprite icon, float* hoverScale, float al
         DrawRectangleRounded(scaledBounds, 0.2f, 8, grayFill);
 
 
-        if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+        if (IsAppMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
             isClicked = true;
         }
     } else {
@@ -435,29 +581,101 @@ bool DrawSpriteButton(Rectangle bounds, Sprite icon, float* hoverScale, float al
 }
 
 
-void SetNewColors(Shader* shader, Color lightColor, Color darkColor) {
+// Only touches the uniform block, the actual upload happens in BeginShaderProgram if anything changed.
+void SetNewColors(ShaderUniformBlock* uniforms, Color lightColor, Color darkColor) {
     state.lightColor = lightColor;
     state.darkColor = darkColor;
 
-    if (state.ditherShader.id > 0) {
-        int darkColorLoc = GetShaderLocation(*shader, "darkColor");
-        int lightColorLoc = GetShaderLocation(*shader, "lightColor");
+    // Set even if the shader didn't load, a hot reload can still bring it back later.
+    float darkColorVec[4] = {darkColor.r/256.0, darkColor.g/256.0, darkColor.b/256.0, 1};
+    float lightColorVec[4] = {lightColor.r/256.0, lightColor.g/256.0, lightColor.b/256.0, 1};
+    SetUniformBlockValue(uniforms, &state.ditherProgram, DITHER_DARK_COLOR, darkColorVec);
+    SetUniformBlockValue(uniforms, &state.ditherProgram, DITHER_LIGHT_COLOR, lightColorVec);
+}
+
 
-        if (darkColorLoc != -1 && lightColorLoc != -1) {
-            float darkColorVec[4] = {darkColor.r/256.0, darkColor.g/256.0, darkColor.b/256.0, 1};
-            float lightColorVec[4] = {lightColor.r/256.0, lightColor.g/256.0, lightColor.b/256.0, 1};
-            SetShaderValue(*shader, darkColorLoc, darkColorVec, SHADER_UNIFORM_VEC4);
-            SetShaderValue(*shader, lightColorLoc, lightColorVec, SHADER_UNIFORM_VEC4);
-        } else {
-            TraceLog(LOG_WARNING, "Shader uniform locations not found");
+// Makes palette index the current one, for both the UI (respecting dark mode) and the video.
+void SelectPalette(int index) {
+    Palette palette = state.colorPalettes[index];
+    if (state.flipColors) SetNewColors(&state.uiUniforms, palette.darkColor, palette.lightColor);
+    else SetNewColors(&state.uiUniforms, palette.lightColor, palette.darkColor);
+    SetNewColors(&state.videoUniforms, palette.lightColor, palette.darkColor);
+    state.colorIndex = index;
+}
+
+
+// Resources are looked up next to the working directory first (that's how it's always been run),
+// then next to the executable.
+const char* ResolveResourcePath(const char* fileName) {
+    if (FileExists(fileName)) return fileName;
+    return TextFormat("%s%s", GetApplicationDirectory(), fileName);
+}
+
+
+// Grows the render targets as soon as the window outgrows them, but only gives memory back
+// once a resize has settled, so dragging the window edge doesn't allocate every frame.
+void UpdateRenderTargets(bool settled) {
+    if (state.pixelScale == 1) {
+        ReleaseRenderTarget(state.uiTarget);
+        state.uiTarget = (RenderTexture2D){0};
+    }
+    RenderTexture2D* targets[3] = {&state.renderTarget, &state.videoTarget, &state.uiTarget};
+    int targetCount = (state.pixelScale > 1) ? 3 : 2;
+    for (int i = 0; i < targetCount; i++) {
+        if (!RenderTargetFits(*targets[i], state.windowWidth, state.windowHeight)) {
+            ReleaseRenderTarget(*targets[i]);
+            *targets[i] = AcquireRenderTarget(state.windowWidth, state.windowHeight);
+        } else if (settled && RenderTargetOversized(*targets[i], state.windowWidth, state.windowHeight)) {
+            // A plain acquire would happily hand the same oversized target straight back
+            RenderTexture2D target = AcquireRenderTargetExact(state.windowWidth, state.windowHeight);
+            ReleaseRenderTarget(*targets[i]);
+            *targets[i] = target;
         }
+    }
+    if (settled) TrimRenderTargetPool();
+
+    // Both patterns are anchored to the bottom-left of the low-res layout, so they line up.
+    // Scaled up, the UI is dithered into uiTarget at layout size so the shader runs once per layout pixel, not per screen pixel.
+    // At 1x it's dithered on the way to the screen instead (one pass less), where the layout may hang off the bottom edge.
+    // The video is dithered inside its own target at layout size, where the bottom edge isn't at y = 0.
+    float uiOrigin[2] = {0, (float)(GetAppScreenHeight() - state.windowHeight)};
+    if (state.pixelScale > 1) uiOrigin[1] = (float)(state.uiTarget.texture.height - state.windowHeight);
+    SetUniformBlockValue(&state.uiUniforms, &state.ditherProgram, DITHER_PATTERN_ORIGIN, uiOrigin);
+
+    float videoOrigin[2] = {0, (float)(state.videoTarget.texture.height - state.windowHeight)};
+    SetUniformBlockValue(&state.videoUniforms, &state.ditherProgram, DITHER_PATTERN_ORIGIN, videoOrigin);
+}
+
+
+// Works out the layout size from the real window size and the pixel scale setting.
+void ApplyPixelScale(bool settled) {
+    int screenWidth = GetAppScreenWidth();
+    int screenHeight = GetAppScreenHeight();
+
+    int scale = 1;
+    if (state.pixelScaleSetting == PIXEL_SCALE_AUTO) {
+        scale = (int)fminf(screenWidth / 1280, screenHeight / 720);
     } else {
-        TraceLog(LOG_WARNING, "Colors unchanged as shader was not loaded.");
+        scale = (int)fminf(state.pixelScaleSetting, fminf(screenWidth / 640, screenHeight / 360));
     }
+    state.pixelScale = (int)fminf(fmaxf(scale, 1), PIXEL_SCALE_MAX);
+
+    // Round up so the scaled layout always covers the whole window
+    state.windowWidth = (screenWidth + state.pixelScale - 1) / state.pixelScale;
+    state.windowHeight = (screenHeight + state.pixelScale - 1) / state.pixelScale;
+    SetAppMouseScale(1.0f / state.pixelScale, 1.0f / state.pixelScale);
+
+    if (IsHeadless() && (state.screenTarget.texture.width != screenWidth || state.screenTarget.texture.height != screenHeight)) {
+        if (state.screenTarget.id != 0) UnloadRenderTexture(state.screenTarget);
+        state.screenTarget = LoadRenderTexture(screenWidth, screenHeight);
+    }
+
+    UpdateRenderTargets(settled);
 }
 
 
 void InitApp() {
+    InitAppMemory();
     state.windowWidth = 1280;
     state.windowHeight = 720;
     state.looping = true;
@@ -465,24 +683,49 @@ void InitApp() {
     InitPalettes();
     InitSprites();
 
+    // Headless runs still need a GL context, just not a visible window
+    if (IsHeadless()) SetConfigFlags(FLAG_WINDOW_HIDDEN);
     InitWindow(state.windowWidth, state.windowHeight, "FlipFilter");
     InitAudioDevice();
     SetWindowState(FLAG_WINDOW_RESIZABLE);
     SetTargetFPS(GetMonitorRefreshRate(GetCurrentMonitor()));
-
-    // Load shader (check if it loaded successfully)
-    state.ditherShader = LoadShader(NULL, "dither.fs");
-    state.videoShader = LoadShader(NULL, "dither.fs");
+    // InitWindow seeds from the clock, headless runs need the same background circles every time
+    if (IsHeadless()) SetRandomSeed(HEADLESS_RANDOM_SEED);
+
+    // Load shader once, the UI and the video only differ by uniform block.
+    // Compiled programs are cached next to the executable, and dither.fs is reloaded whenever it's saved.
+    InitShaderManager(TextFormat("%scache/shaders", GetApplicationDirectory()));
+    state.ditherProgram = LoadShaderProgram(ResolveResourcePath("dither.fs"), ditherUniforms, DITHER_UNIFORM_COUNT);
+    WatchShaderProgram(&state.ditherProgram);
+    state.paletteProgram = LoadShaderProgram(ResolveResourcePath("palette.fs"), paletteUniforms, 1);
+    WatchShaderProgram(&state.paletteProgram);
     state.flipColors = false;
 
+    // The palette grid's mask is always white on black, palette.fs swaps in the real colors
+    float white[4] = {1, 1, 1, 1};
+    float black[4] = {0, 0, 0, 1};
+    SetUniformBlockValue(&state.maskUniforms, &state.ditherProgram, DITHER_LIGHT_COLOR, white);
+    SetUniformBlockValue(&state.maskUniforms, &state.ditherProgram, DITHER_DARK_COLOR, black);
+
+    Image paletteImage = GenImageColor(state.colorCount, 2, BLACK);
+    for (int i = 0; i < state.colorCount; i++) {
+        ImageDrawPixel(&paletteImage, i, 0, state.colorPalettes[i].lightColor);
+        ImageDrawPixel(&paletteImage, i, 1, state.colorPalettes[i].darkColor);
+    }
+    state.paletteTexture = LoadTextureFromImage(paletteImage);
+    UnloadImage(paletteImage);
+
     // Create render texture
-    state.renderTarget = LoadRenderTexture(state.windowWidth, state.windowHeight);
-    state.videoTarget = LoadRenderTexture(state.windowWidth, state.windowHeight);
+    state.pixelScaleSetting = PIXEL_SCALE_AUTO;
+    ApplyPixelScale(true);
+
+    InitFrameCache(TextFormat("%scache/frames", GetApplicationDirectory()), (state.frameCacheMB == FRAME_CACHE_AUTO) ? FRAME_CACHE_AUTO : state.frameCacheMB * 1024LL * 1024LL);
+    InitExportQueue();
 
     // Only set shader uniforms if shader loaded successfully
     state.colorIndex = 2;
-    SetNewColors(&state.ditherShader, state.colorPalettes[state.colorIndex].lightColor, state.colorPalettes[state.colorIndex].darkColor);
-    SetNewColors(&state.videoShader, state.colorPalettes[state.colorIndex].lightColor, state.colorPalettes[state.colorIndex].darkColor);
+    SetNewColors(&state.uiUniforms, state.colorPalettes[state.colorIndex].lightColor, state.colorPalettes[state.colorIndex].darkColor);
+    SetNewColors(&state.videoUniforms, state.colorPalettes[state.colorIndex].lightColor, state.colorPalettes[state.colorIndex].darkColor);
 
     // Initialize background
     InitBackgroundCircles();
@@ -502,25 +745,90 @@ void InitApp() {
     // Get current directory
     getcwd(state.currentPath, sizeof(state.currentPath));
     LoadDirectory(state.currentPath);
+
+    // Without --library the folder we started in is the library. Headless runs leave it alone, it's not deterministic.
+    if (!IsHeadless()) {
+        if (state.libraryRootCount == 0) state.libraryRoots[state.libraryRootCount++] = state.currentPath;
+        InitLibraryIndex(TextFormat("%scache/library.idx", GetApplicationDirectory()), state.libraryRoots, state.libraryRootCount);
+    }
+}
+
+
+// Playback goes through these so a cached clip without a media session plays like any other.
+double GetPlaybackPosition() {
+    return (state.video != NULL) ? GetMediaPosition(*state.video) : state.cachedPosition;
+}
+
+
+bool IsPlaybackPlaying() {
+    return (state.video != NULL) ? GetMediaState(*state.video) == MEDIA_STATE_PLAYING : state.cachedPlaying;
+}
+
+
+void SetPlaybackPlaying(bool playing) {
+    if (state.video != NULL) SetMediaState(*state.video, (playing) ? MEDIA_STATE_PLAYING : MEDIA_STATE_PAUSED);
+    else state.cachedPlaying = playing;
+}
+
+
+void StepPlayback(SyncStep step) {
+    if (state.video != NULL) {
+        if (step.seekTo >= 0) SetMediaPosition(*state.video, step.seekTo);
+        UpdateMediaEx(state.video, step.step);
+        return;
+    }
+
+    // Same end-of-clip behaviour as a media session: wrap when looping, otherwise stop on the last frame
+    double duration = GetFrameCacheFrameCount(state.frameCache) / GetFrameCacheFrameRate(state.frameCache);
+    if (step.seekTo >= 0) state.cachedPosition = step.seekTo;
+    if (state.cachedPlaying) state.cachedPosition += step.step;
+    if (state.cachedPosition >= duration) {
+        if (state.looping && duration > 0) {
+            state.cachedPosition = fmod(state.cachedPosition, duration);
+        } else {
+            state.cachedPosition = fmax(duration - 1.0 / GetFrameCacheFrameRate(state.frameCache), 0.0);
+            state.cachedPlaying = false;
+        }
+    }
 }
 
 
 void UpdateApp() {
+    UpdateShaderManager();
+    UpdateMediaPool();
+
+    if (IsKeyPressed(KEY_F3)) state.showSyncStats = !state.showSyncStats;
+    if (IsKeyPressed(KEY_F4)) {
+        // Switching starts the stats over, they'd be meaningless mixed
+        state.syncPolicy = (state.syncPolicy + 1) % SYNC_POLICY_COUNT;
+        if (state.videoLoaded) {
+            ResetSyncClock(&state.syncClock, state.syncPolicy, GetPlaybackPosition(), 1.0 / state.syncClock.frameDuration);
+        }
+    }
+
+    // One look at the export queue a frame, everything drawn about it this frame comes from here
+    state.exportJobCount = GetExportJobs(state.exportJobs, EXPORT_QUEUE_MAX_JOBS);
+    state.renderProgress = GetExportQueueProgress(&state.renderEta);
+    state.isRendering = IsExportQueueBusy();
+
     // Handle window resize
-    if (IsWindowResized()) {
-        state.windowWidth = GetScreenWidth();
-        state.windowHeight = GetScreenHeight();
+    if (IsAppWindowResized()) {
+        ApplyPixelScale(false);
+        state.resizeSettleTimer = RESIZE_SETTLE_TIME;
+    }
 
-        // Reload render texture with new size
-        UnloadRenderTexture(state.renderTarget);
-        state.renderTarget = LoadRenderTexture(state.windowWidth, state.windowHeight);
+    if (state.pixelScaleChanged) {
+        ApplyPixelScale(true);
+        state.pixelScaleChanged = false;
+    }
 
-        UnloadRenderTexture(state.videoTarget);
-        state.videoTarget = LoadRenderTexture(state.windowWidth, state.windowHeight);
+    if (state.resizeSettleTimer > 0) {
+        state.resizeSettleTimer -= GetAppFrameTime();
+        if (state.resizeSettleTimer <= 0) UpdateRenderTargets(true);
     }
 
     // Update camera position
-    state.cameraTransitionTimer += GetFrameTime();
+    state.cameraTransitionTimer += GetAppFrameTime();
     float cameraT = fminf(state.cameraTransitionTimer / 1.0f, 1.0f);
     float easedT = EaseOutCubic(cameraT);
 
@@ -529,7 +837,7 @@ void UpdateApp() {
 
     // Update circle opacity with fade in
     if (state.circleOpacityTimer < 1.0f) {
-        state.circleOpacityTimer += GetFrameTime() / 1.5f;
+        state.circleOpacityTimer += GetAppFrameTime() / 1.5f;
         float opacity = EaseOutCubic(fminf(state.circleOpacityTimer, 1.0f));
         for (int i = 0; i < state.circleCount; i++) {
             state.circles[i].opacity = opacity * 0.3f;
@@ -538,7 +846,7 @@ void UpdateApp() {
 
     // Update screen fade in
     if (state.screenFadeTimer < state.screenFadeInDuration) {
-        state.screenFadeTimer += GetFrameTime();
+        state.screenFadeTimer += GetAppFrameTime();
     }
 
     // Update smooth scroll
@@ -546,7 +854,7 @@ void UpdateApp() {
 
     // Handle transitions
     if (state.transitioning) {
-        state.transitionTimer += GetFrameTime();
+        state.transitionTimer += GetAppFrameTime();
         if (state.transitionTimer >= state.transitionDuration) {
             state.currentScreen = state.targetScreen;
             state.transitioning = false;
@@ -603,17 +911,185 @@ void DrawStartScreen() {
 }
 
 
+void OpenCachedPlayback(FrameCache* cache) {
+    int width = GetFrameCacheWidth(cache);
+    int height = GetFrameCacheHeight(cache);
+
+    state.frameCache = cache;
+    state.frameCachePixels = (unsigned char*)AcquireFrameBuffer((size_t)width * height);
+    Image image = {state.frameCachePixels, width, height, 1, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE};
+    state.frameCacheTexture = LoadTextureFromImage(image);
+    state.frameCacheFrame = -1;
+    state.cachedPosition = 0.0;
+    state.cachedPlaying = true;
+}
+
+
+void CloseCachedPlayback() {
+    if (state.frameCache == NULL) return;
+    CloseFrameCache(state.frameCache);
+    UnloadTexture(state.frameCacheTexture);
+    ReleaseFrameBuffer(state.frameCachePixels);
+    state.frameCache = NULL;
+    state.frameCachePixels = NULL;
+}
+
+
+// Whatever's showing the current video, the decoder's texture or the one fed from the frame cache.
+Texture2D GetVideoTexture() {
+    return (state.frameCache != NULL) ? state.frameCacheTexture : state.video->videoTexture;
+}
+
+
+// Queues videoPath as a GIF next to it. fit scales it into width x height the way the player does,
+// otherwise it's exactly that size. Either way the pattern matches the preview.
+int QueueGifExport(const char* videoPath, int width, int height, bool fit) {
+    ExportOptions options = {0};
+    options.format = EXPORT_FORMAT_GIF;
+    options.width = width;
+    options.height = height;
+    options.fit = fit;
+    options.lightColor = state.colorPalettes[state.colorIndex].lightColor;
+    options.darkColor = state.colorPalettes[state.colorIndex].darkColor;
+
+    const char* outputPath = TextFormat("%s/%s.gif", GetDirectoryPath(videoPath), GetFileNameWithoutExt(videoPath));
+    return QueueExport(videoPath, outputPath, &options);
+}
+
+
+const ExportJobInfo* FindExportJob(int id) {
+    for (int i = 0; i < state.exportJobCount; i++) {
+        if (state.exportJobs[i].id == id) return &state.exportJobs[i];
+    }
+    return NULL;
+}
+
+
+bool IsExportJobActive(const ExportJobInfo* job) {
+    return job != NULL && (job->state == EXPORT_JOB_QUEUED || job->state == EXPORT_JOB_RUNNING || job->state == EXPORT_JOB_PAUSED);
+}
+
+
+const char* FormatEta(double seconds) {
+    if (seconds < 0) return "";
+    int total = (int)(seconds + 0.5);
+    return FrameTextFormat(", %d:%02d left", total / 60, total % 60);
+}
+
+
+// The explorer's side panel: every export the queue knows about, with pause and cancel for the ones still going.
+void DrawExportQueue(Rectangle bounds, float alpha) {
+    static float clearHoverScale = 1.0f;
+    static float pauseHoverScales[EXPORT_QUEUE_MAX_JOBS];
+    static float cancelHoverScales[EXPORT_QUEUE_MAX_JOBS];
+    float rowHeight = 60;
+
+    DrawRectangleRec(bounds, ColorAlpha(WHITE, alpha));
+
+    // Header, overall progress and a way to get rid of what's done
+    const char* header = (state.isRendering) ? FrameTextFormat("Exports %d%%%s", (int)(state.renderProgress * 100), FormatEta(state.renderEta)) : "Exports done";
+    DrawText(header, (int)bounds.x + 10, (int)bounds.y + 15, 20, ColorAlpha(BLACK, alpha));
+    bool anyFinished = false;
+    for (int i = 0; i < state.exportJobCount; i++) anyFinished |= !IsExportJobActive(&state.exportJobs[i]);
+    Rectangle clearButton = {bounds.x + bounds.width - 80, bounds.y + 10, 70, 30};
+    if (anyFinished && DrawButton(clearButton, "Clear", &clearHoverScale, alpha) && alpha > 0.9f) ClearFinishedExports();
+    DrawLineEx((Vector2){bounds.x, bounds.y + 50}, (Vector2){bounds.x + bounds.width, bounds.y + 50}, 2, ColorAlpha(BLACK, alpha));
+
+    // As many as fit, clearing finished ones makes room for the rest
+    for (int i = 0; i < state.exportJobCount; i++) {
+        const ExportJobInfo* job = &state.exportJobs[i];
+        Rectangle row = {bounds.x, bounds.y + 52 + i * rowHeight, bounds.width, rowHeight};
+        if (row.y + row.height > bounds.y + bounds.height) break;
+
+        const char* status;
+        switch (job->state) {
+            case EXPORT_JOB_QUEUED: status = "Queued"; break;
+            case EXPORT_JOB_RUNNING: status = FrameTextFormat("%d%%%s", (int)(job->progress * 100), FormatEta(job->eta)); break;
+            case EXPORT_JOB_PAUSED: status = FrameTextFormat("Paused at %d%%", (int)(job->progress * 100)); break;
+            case EXPORT_JOB_DONE: status = "Done"; break;
+            case EXPORT_JOB_FAILED: status = "Failed"; break;
+            default: status = "Cancelled"; break;
+        }
+
+        bool active = IsExportJobActive(job);
+        int textWidth = (int)row.width - ((active) ? 100 : 20);
+        BeginScissorMode((int)row.x + 10, (int)row.y, textWidth, (int)row.height);
+        DrawText(GetFileName(job->inputPath), (int)row.x + 10, (int)row.y + 8, 20, ColorAlpha(BLACK, alpha));
+        DrawText(status, (int)row.x + 10, (int)row.y + 32, 20, ColorAlpha(GRAY, alpha));
+        EndScissorMode();
+
+        // Progress along the bottom of the row
+        DrawRectangleRec((Rectangle){row.x, row.y + row.height - 4, row.width * job->progress, 4}, ColorAlpha(BLACK, alpha));
+
+        if (active) {
+            if (pauseHoverScales[i] == 0) pauseHoverScales[i] = 1.0f;
+            if (cancelHoverScales[i] == 0) cancelHoverScales[i] = 1.0f;
+            Rectangle pauseButton = {row.x + row.width - 85, row.y + 15, 35, 30};
+            Rectangle cancelButton = {row.x + row.width - 45, row.y + 15, 35, 30};
+            bool paused = job->state == EXPORT_JOB_PAUSED;
+            if (DrawButton(pauseButton, (paused) ? ">" : "||", &pauseHoverScales[i], alpha) && alpha > 0.9f) PauseExport(job->id, !paused);
+            if (DrawButton(cancelButton, "x", &cancelHoverScales[i], alpha) && alpha > 0.9f) CancelExport(job->id);
+        }
+        DrawLineEx((Vector2){row.x, row.y + row.height}, (Vector2){row.x + row.width, row.y + row.height}, 2, ColorAlpha(BLACK, alpha));
+    }
+
+    DrawRectangleLinesEx(bounds, 2, ColorAlpha(BLACK, alpha));
+}
+
+
 void DrawExplorerScreen() {
     float alpha = EaseOutCubic(fminf(state.transitionTimer / state.transitionDuration, 1.0f));
     if (state.transitioning && state.currentScreen == SCREEN_EXPLORER) alpha = 1 - alpha;
 
-    // Path input at top
-    Rectangle pathInputRect = {20, 20, state.windowWidth - 40, 40};
+    // Path input at top, the search box takes the right end of the row
+    Rectangle searchRect = {state.windowWidth - 340, 20, 320, 40};
+    Rectangle pathInputRect = {20, 20, state.windowWidth - 40 - searchRect.width - 10, 40};
+    int pathTextWidth = (int)pathInputRect.width - 20;
 
     DrawRectangleRounded(pathInputRect, 0.2f, 8, ColorAlpha(WHITE, alpha));
     DrawRectangleRoundedLines(pathInputRect, 0.2f, 8, ColorAlpha(BLACK, alpha));
-    BeginScissorMode(30, 30, state.windowWidth - 60, 40);
-    DrawText(state.pathInput, (MeasureText(state.pathInput, 20) > state.windowWidth - 60) ? 30 - (MeasureText(state.pathInput, 20) - (state.windowWidth - 60)) : 30, 30, 20, ColorAlpha(BLACK, alpha));
+    BeginScissorMode(30, 30, pathTextWidth, 40);
+    const char* pathText = (state.searchQuery[0] != '\0') ? FrameTextFormat("Library: %d of %d files", state.searchMatches, GetLibraryFileCount()) : state.pathInput;
+    DrawText(pathText, (MeasureText(pathText, 20) > pathTextWidth) ? 30 - (MeasureText(pathText, 20) - pathTextWidth) : 30, 30, 20, ColorAlpha(BLACK, alpha));
+    EndScissorMode();
+
+    // Search box
+    if (IsAppMouseButtonPressed(MOUSE_LEFT_BUTTON)) state.searchFocused = CheckCollisionPointRec(GetAppMousePosition(), searchRect);
+    bool searchChanged = false;
+    if (state.searchFocused && alpha > 0.9f) {
+        int length = (int)strlen(state.searchQuery);
+        int codepoint;
+        while ((codepoint = GetCharPressed()) > 0) {
+            int size = 0;
+            const char* utf8 = CodepointToUTF8(codepoint, &size);
+            if (length + size < (int)sizeof(state.searchQuery)) {
+                memcpy(state.searchQuery + length, utf8, size);
+                length += size;
+                state.searchQuery[length] = '\0';
+                searchChanged = true;
+            }
+        }
+        if ((IsKeyPressed(KEY_BACKSPACE) || IsKeyPressedRepeat(KEY_BACKSPACE)) && length > 0) {
+            // Back up over a whole UTF-8 sequence
+            do length--; while (length > 0 && (state.searchQuery[length] & 0xC0) == 0x80);
+            state.searchQuery[length] = '\0';
+            searchChanged = true;
+        }
+    }
+    if (searchChanged && state.searchQuery[0] == '\0') LoadDirectory(state.currentPath);
+    else if (searchChanged || (state.searchQuery[0] != '\0' && GetLibraryVersion() != state.searchVersion)) LoadSearchResults();
+
+    DrawRectangleRounded(searchRect, 0.2f, 8, ColorAlpha(state.searchFocused ? (Color){150, 150, 150, 255} : WHITE, alpha));
+    DrawRectangleRoundedLines(searchRect, 0.2f, 8, ColorAlpha(BLACK, alpha));
+    BeginScissorMode((int)searchRect.x + 10, 30, (int)searchRect.width - 20, 40);
+    if (state.searchQuery[0] != '\0' || state.searchFocused) {
+        const char* searchText = FrameTextFormat("%s%s", state.searchQuery, (state.searchFocused) ? "_" : "");
+        int searchTextWidth = MeasureText(searchText, 20);
+        int searchTextX = (int)searchRect.x + 10 - ((searchTextWidth > searchRect.width - 20) ? searchTextWidth - (int)(searchRect.width - 20) : 0);
+        DrawText(searchText, searchTextX, 30, 20, ColorAlpha(BLACK, alpha));
+    } else {
+        DrawText(IsLibraryIndexing() ? "Search (indexing..)" : "Search library..", (int)searchRect.x + 10, 30, 20, ColorAlpha(GRAY, alpha));
+    }
     EndScissorMode();
 
     // View button
@@ -622,8 +1098,9 @@ void DrawExplorerScreen() {
     if (state.selectedFileIndex >= 0 &&
         state.files[state.selectedFileIndex].type == FILE_TYPE_VIDEO &&
         DrawButton(viewButton, "View Media", &viewHoverScale, alpha) && alpha > 0.9f && !state.transitioning) {
-        strcpy(state.selectedVideoPath, state.files[state.selectedFileIndex].path);
+        CopyString(state.selectedVideoPath, sizeof(state.selectedVideoPath), state.files[state.selectedFileIndex].path);
         state.videoLoaded = false;
+        CloseCachedPlayback();
         TransitionToScreen(SCREEN_VIEWING);
     }
 
@@ -634,12 +1111,33 @@ void DrawExplorerScreen() {
         TransitionToScreen(SCREEN_START);
     }
 
-    // File list
+    // Export button, queues every selected video (ctrl+click picks more than one)
+    int exportCount = 0;
+    for (int i = 0; i < state.fileCount; i++) exportCount += state.files[i].selected && state.files[i].type == FILE_TYPE_VIDEO;
+    static float exportHoverScale = 1.0f;
+    Rectangle exportButton = {240, state.windowHeight - 80, 200, 50};
+    if (exportCount > 0 &&
+        DrawButton(exportButton, (exportCount == 1) ? "Export GIF" : FrameTextFormat("Export %d GIFs", exportCount), &exportHoverScale, alpha) &&
+        alpha > 0.9f && !state.transitioning) {
+        // Sized for the view screen, the same as exporting from there at this window size
+        for (int i = 0; i < state.fileCount; i++) {
+            if (state.files[i].selected && state.files[i].type == FILE_TYPE_VIDEO) {
+                QueueGifExport(state.files[i].path, state.windowWidth - 40, state.windowHeight - 120, true);
+            }
+        }
+    }
+
+    // File list, the export queue takes the right side while there's anything in it
     float listY = 80;
     float listHeight = state.windowHeight - 180;
     float itemHeight = 50;
 
     Rectangle listBounds = {20, listY, state.windowWidth - 40, listHeight};
+    if (state.exportJobCount > 0) {
+        Rectangle queueBounds = {searchRect.x, listY, searchRect.width, listHeight};
+        listBounds.width = queueBounds.x - 10 - listBounds.x;
+        DrawExportQueue(queueBounds, alpha);
+    }
     BeginScissorMode((int)listBounds.x, (int)listBounds.y,
                      (int)listBounds.width, (int)listBounds.height);
 
@@ -647,7 +1145,7 @@ void DrawExplorerScreen() {
         float y = listY + i * itemHeight + state.scrollOffset;
         Rectangle itemRect = {listBounds.x, y, listBounds.width, itemHeight};
 
-        bool isHovered = CheckCollisionPointRec(GetMousePosition(), itemRect);
+        bool isHovered = CheckCollisionPointRec(GetAppMousePosition(), itemRect);
 
         // Background
         if (state.files[i].selected) {
@@ -703,8 +1201,14 @@ void DrawExplorerScreen() {
         DrawText(state.files[i].name, (int)itemRect.x + 50, (int)itemRect.y + 15, 20, ColorAlpha(BLACK, alpha));
 
         // Handle clicks (only when fully faded in)
-        if (alpha > 0.9f && isHovered && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
-            if (state.selectedFileIndex == i) {
+        if (alpha > 0.9f && isHovered && IsAppMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+            bool control = IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL);
+            if (control && state.files[i].type == FILE_TYPE_VIDEO) {
+                // Add to (or take out of) the selection, for exporting several at once
+                state.files[i].selected = !state.files[i].selected;
+                if (state.files[i].selected) state.selectedFileIndex = i;
+                else if (state.selectedFileIndex == i) state.selectedFileIndex = -1;
+            } else if (state.selectedFileIndex == i) {
                 // Double click
                 if (state.files[i].type != FILE_TYPE_VIDEO) {
                     LoadDirectory(state.files[i].path);
@@ -716,6 +1220,11 @@ void DrawExplorerScreen() {
                 }
                 state.files[i].selected = true;
                 state.selectedFileIndex = i;
+
+                // Open it while the user decides, so "View Media" doesn't have to wait on the codec
+                if (state.files[i].type == FILE_TYPE_VIDEO) {
+                    PrefetchMediaSession(state.files[i].path, HasFrameCache(state.files[i].path) ? MEDIA_LOAD_NO_VIDEO : MEDIA_LOAD_AV);
+                }
             }
         }
     }
@@ -723,7 +1232,7 @@ void DrawExplorerScreen() {
     EndScissorMode();
 
     // Scroll handling
-    float mouseWheel = GetMouseWheelMove();
+    float mouseWheel = GetAppMouseWheelMove();
     if (mouseWheel != 0) {
         state.targetScrollOffset += mouseWheel * 30;
         state.targetScrollOffset = fmaxf(state.targetScrollOffset,
@@ -736,27 +1245,172 @@ void DrawExplorerScreen() {
 }
 
 
+// Picks the column count that gives the biggest cells for the video's aspect ratio inside bounds.
+// Cell sizes are whole pixels so the mask lands on the grid pixel for pixel.
+// Only the layout, this runs while the render target is bound. UpdatePaletteGridTarget sizes the mask after.
+void LayoutPaletteGrid(Rectangle bounds, float videoAspect) {
+    PaletteGrid* grid = &state.paletteGrid;
+    grid->cellWidth = grid->cellHeight = 0;
+
+    for (int columns = 1; columns <= state.colorCount; columns++) {
+        int rows = (state.colorCount + columns - 1) / columns;
+        float width = (bounds.width - (columns - 1) * PALETTE_GRID_GAP) / columns;
+        float height = (bounds.height - rows * PALETTE_GRID_LABEL_HEIGHT - (rows - 1) * PALETTE_GRID_GAP) / rows;
+        if (width / height > videoAspect) width = height * videoAspect;
+        else height = width / videoAspect;
+
+        if ((int)width * (int)height > grid->cellWidth * grid->cellHeight) {
+            grid->columns = columns;
+            grid->rows = rows;
+            grid->cellWidth = (int)width;
+            grid->cellHeight = (int)height;
+        }
+    }
+
+    grid->area.width = grid->columns * grid->cellWidth + (grid->columns - 1) * PALETTE_GRID_GAP;
+    grid->area.height = grid->rows * (grid->cellHeight + PALETTE_GRID_LABEL_HEIGHT) + (grid->rows - 1) * PALETTE_GRID_GAP;
+    grid->area.x = (int)(bounds.x + (bounds.width - grid->area.width) / 2);
+    grid->area.y = (int)(bounds.y + (bounds.height - grid->area.height) / 2);
+}
+
+
+// Loading a render target binds the default framebuffer, so this has to wait until no texture mode is active.
+void UpdatePaletteGridTarget() {
+    PaletteGrid* grid = &state.paletteGrid;
+    if (grid->cellWidth > 0 && grid->cellHeight > 0 && !RenderTargetFits(grid->maskTarget, grid->cellWidth, grid->cellHeight)) {
+        ReleaseRenderTarget(grid->maskTarget);
+        grid->maskTarget = AcquireRenderTarget(grid->cellWidth, grid->cellHeight);
+    }
+}
+
+
+Rectangle GetPaletteGridCell(int index) {
+    PaletteGrid* grid = &state.paletteGrid;
+    int column = index % grid->columns;
+    int row = index / grid->columns;
+    return (Rectangle){
+            grid->area.x + column * (grid->cellWidth + PALETTE_GRID_GAP),
+            grid->area.y + row * (grid->cellHeight + PALETTE_GRID_LABEL_HEIGHT + PALETTE_GRID_GAP),
+            grid->cellWidth, grid->cellHeight
+    };
+}
+
+
+void ClosePaletteGrid() {
+    state.paletteGrid.enabled = false;
+    ReleaseRenderTarget(state.paletteGrid.maskTarget);
+    state.paletteGrid.maskTarget = (RenderTexture2D){0};
+}
+
+
+// Cell frames and palette names, clicking a cell picks that palette and goes back to the single view.
+void DrawPaletteGrid(float alpha) {
+    for (int i = 0; i < state.colorCount; i++) {
+        Rectangle cell = GetPaletteGridCell(i);
+        bool isHovered = CheckCollisionPointRec(GetAppMousePosition(), cell);
+        bool isCurrent = (i == state.colorIndex);
+
+        Color frameColor = (isCurrent || isHovered) ? GRAY : ((state.flipColors) ? WHITE : BLACK);
+        DrawRectangleRec((Rectangle){cell.x - 4, cell.y - 4, cell.width + 8, cell.height + 8}, ColorAlpha(frameColor, alpha));
+
+        const char* name = state.colorPalettes[i].name;
+        int nameX = (int)(cell.x + (cell.width - MeasureText(name, 20)) / 2);
+        int nameY = (int)(cell.y + cell.height + 6);
+        if (isCurrent) {
+            for (int dx = -2; dx <= 2; dx += 2) {
+                for (int dy = -2; dy <= 2; dy += 2) {
+                    if (dx != 0 || dy != 0) DrawText(name, nameX + dx, nameY + dy, 20, ColorAlpha(WHITE, alpha));
+                }
+            }
+        }
+        DrawText(name, nameX, nameY, 20, ColorAlpha(BLACK, alpha));
+
+        if (alpha > 0.9f && isHovered && IsAppMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+            SelectPalette(i);
+            ClosePaletteGrid();
+        }
+    }
+}
+
+
+// Playback sync numbers in the top-left corner, toggled with F3.
+// Drawn over the video target so the video doesn't cover it, which also means it isn't dithered.
+void DrawSyncStats() {
+    SyncClock* clock = &state.syncClock;
+    const char* lines[] = {
+            FrameTextFormat("Sync: %s (F4)", GetSyncPolicyName(clock->policy)),
+            FrameTextFormat("Drift: %+.1fms (max %.1fms)", clock->drift * 1000.0, clock->maxDrift * 1000.0),
+            FrameTextFormat("Shown: %d  Dropped: %d", clock->framesShown, clock->framesDropped),
+            FrameTextFormat("Seeks: %d  Held: %.2fs", clock->seeks, clock->heldTime),
+            (state.frameCache != NULL) ? "Source: frame cache" : "Source: decoder",
+    };
+    int lineCount = sizeof(lines) / sizeof(lines[0]);
+
+    Rectangle panel = {30, 30, 300, 10 + lineCount * 22};
+    DrawRectangleRec(panel, WHITE);
+    DrawRectangleLinesEx(panel, 2, BLACK);
+    for (int i = 0; i < lineCount; i++) {
+        DrawText(lines[i], (int)panel.x + 10, (int)panel.y + 8 + i * 22, 20, BLACK);
+    }
+}
+
+
 void DrawViewScreen() {
+    if (state.videoLoaded) state.playbackFrames++;
+
     float alpha = EaseOutCubic(fminf(state.transitionTimer / state.transitionDuration, 1.0f));
     if (state.transitioning && state.currentScreen == SCREEN_VIEWING) alpha = 1 - alpha;
 
     if (!state.videoLoaded && strlen(state.selectedVideoPath) > 0) {
-        UnloadRenderTexture(state.videoTarget);
-        state.videoTarget = LoadRenderTexture(state.windowWidth, state.windowHeight);
-        UnloadMedia(&state.video);
-        state.video = LoadMedia(state.selectedVideoPath);
-        if (state.muted) SetAudioStreamVolume(state.video.audioStream, 0.0f);
-        state.videoLoaded = true;
-        if (state.looping) SetMediaLooping(state.video, true);
+        // Seen it before: the picture comes off disk and only the audio is decoded
+        // A clip without audio has nothing to decode at all then, the sync clock keeps the time by itself.
+        FrameCache* cache = OpenFrameCache(state.selectedVideoPath);
+        state.video = (cache != NULL) ? AcquireMediaSession(state.selectedVideoPath, MEDIA_LOAD_NO_VIDEO) : NULL;
+        if (cache != NULL) {
+            OpenCachedPlayback(cache);
+        } else {
+            // Not cached yet, play it the normal way and cache it for next time
+            state.video = AcquireMediaSession(state.selectedVideoPath, MEDIA_LOAD_AV);
+            if (state.video != NULL) RequestFrameCache(state.selectedVideoPath);
+        }
+
+        if (state.video != NULL) {
+            SetAudioStreamVolume(state.video->audioStream, (state.muted) ? 0.0f : 1.0f);
+            SetMediaLooping(*state.video, state.looping);
+            SetMediaState(*state.video, MEDIA_STATE_PLAYING);
+        }
+        if (state.video != NULL || state.frameCache != NULL) {
+            state.videoLoaded = true;
+            state.playbackFrames = 0;
+
+            double frameRate = (state.frameCache != NULL) ? GetFrameCacheFrameRate(state.frameCache) : GetMediaProperties(*state.video).avgFPS;
+            ResetSyncClock(&state.syncClock, state.syncPolicy, GetPlaybackPosition(), frameRate);
+        } else {
+            // Don't retry every frame
+            state.selectedVideoPath[0] = '\0';
+        }
     }
 
     Rectangle bounds = {20, 20, state.windowWidth - 40, state.windowHeight - 120};
 
     if (state.videoLoaded) {
-        UpdateMedia(&state.video);
+        // The clock decides how far the media moves, not the refresh rate
+        SyncStep step = UpdateSyncClock(&state.syncClock, GetAppFrameTime(), GetPlaybackPosition(), IsPlaybackPlaying());
+        StepPlayback(step);
+        SettleSyncClock(&state.syncClock, GetPlaybackPosition());
+
+        if (state.frameCache != NULL) {
+            int frame = (int)(GetPlaybackPosition() * GetFrameCacheFrameRate(state.frameCache));
+            if (frame != state.frameCacheFrame) {
+                ExpandFrameCacheFrame(state.frameCache, frame, state.frameCachePixels);
+                UpdateTexture(state.frameCacheTexture, state.frameCachePixels);
+                state.frameCacheFrame = frame;
+            }
+        }
 
         // Calculate video display rectangle maintaining aspect ratio
-        float videoAspect = (float)state.video.videoTexture.width / state.video.videoTexture.height;
+        Texture2D videoTexture = GetVideoTexture();
+        float videoAspect = (float)videoTexture.width / videoTexture.height;
         float boundsAspect = bounds.width / bounds.height;
 
         if (videoAspect > boundsAspect) {
@@ -771,38 +1425,66 @@ void DrawViewScreen() {
             state.videoDisplayRect.y = bounds.y;
         }
 
-        DrawRectangleRec((Rectangle){state.videoDisplayRect.x - 4, state.videoDisplayRect.y - 4, state.videoDisplayRect.width + 8, state.videoDisplayRect.height + 8}, (state.flipColors) ? ColorAlpha(WHITE, alpha) : ColorAlpha(BLACK, alpha));
+        if (state.paletteGrid.enabled) {
+            LayoutPaletteGrid(bounds, videoAspect);
+            DrawPaletteGrid(alpha);
+        } else {
+            DrawRectangleRec((Rectangle){state.videoDisplayRect.x - 4, state.videoDisplayRect.y - 4, state.videoDisplayRect.width + 8, state.videoDisplayRect.height + 8}, (state.flipColors) ? ColorAlpha(WHITE, alpha) : ColorAlpha(BLACK, alpha));
+        }
     }
 
+    // Playback controls sit under whatever's showing
+    float controlsY = (state.paletteGrid.enabled && state.videoLoaded) ? state.paletteGrid.area.y + state.paletteGrid.area.height + 20 : state.videoDisplayRect.y + state.videoDisplayRect.height + 20;
+
     // Explorer button
     static float applyHoverScale = 1.0f;
     Rectangle applyButton = {state.windowWidth - 220, state.windowHeight - 80, 200, 50};
     if (DrawButton(applyButton, "View Another", &applyHoverScale, alpha) && alpha > 0.9f && !state.transitioning) {
+        // Stays open in the pool, coming back to it picks up where it left off
+        PauseActiveMediaSession();
         TransitionToScreen(SCREEN_EXPLORER);
     }
 
-    static float playHoverScale = 1.0f;
-    Rectangle playButton = {state.windowWidth / 2 - 20, state.videoDisplayRect.y + state.videoDisplayRect.height + 20,40, 40};
-    if (DrawSpriteButton(playButton, ((GetMediaState(state.video) == MEDIA_STATE_PLAYING) ? state.sprites.pause : state.sprites.play), &playHoverScale, alpha)) {
-        if (GetMediaState(state.video) == MEDIA_STATE_PLAYING) {
-            SetMediaState(state.video, MEDIA_STATE_PAUSED);
-        } else {
-            SetMediaState(state.video, MEDIA_STATE_PLAYING);
+    // Export button, clicking it again while it runs cancels
+    static float exportHoverScale = 1.0f;
+    Rectangle exportButton = {20, state.windowHeight - 80, 200, 50};
+    const ExportJobInfo* viewJob = FindExportJob(state.viewExportId);
+    bool viewExporting = IsExportJobActive(viewJob);
+    const char* exportText = "Export GIF";
+    if (viewExporting) exportText = (viewJob->state == EXPORT_JOB_QUEUED) ? "Export queued" : FrameTextFormat("Exporting %d%%", (int)(viewJob->progress * 100));
+    if (DrawButton(exportButton, exportText, &exportHoverScale, alpha) && alpha > 0.9f && !state.transitioning) {
+        if (viewExporting) CancelExport(state.viewExportId);
+        else if (state.videoLoaded) {
+            state.viewExportId = QueueGifExport(state.selectedVideoPath, (int)state.videoDisplayRect.width, (int)state.videoDisplayRect.height, false);
         }
     }
 
+    static float playHoverScale = 1.0f;
+    Rectangle playButton = {state.windowWidth / 2 - 20, controlsY, 40, 40};
+    bool playing = state.videoLoaded && IsPlaybackPlaying();
+    if (DrawSpriteButton(playButton, (playing ? state.sprites.pause : state.sprites.play), &playHoverScale, alpha) && state.videoLoaded) {
+        SetPlaybackPlaying(!playing);
+    }
+
     static float loopHoverScale = 1.0f;
-    Rectangle loopButton = {state.windowWidth / 2 - 20 + 60, state.videoDisplayRect.y + state.videoDisplayRect.height + 20,40, 40};
+    Rectangle loopButton = {state.windowWidth / 2 - 20 + 60, controlsY, 40, 40};
     if (DrawSpriteButton(loopButton, (state.looping ? state.sprites.loop : state.sprites.unloop), &loopHoverScale, alpha)) {
         state.looping = !state.looping;
-        SetMediaLooping(state.video, state.looping);
+        if (state.videoLoaded && state.video != NULL) SetMediaLooping(*state.video, state.looping);
     }
 
     static float muteHoverScale = 1.0f;
-    Rectangle muteButton = {state.windowWidth / 2 - 20 - 60, state.videoDisplayRect.y + state.videoDisplayRect.height + 20,40, 40};
+    Rectangle muteButton = {state.windowWidth / 2 - 20 - 60, controlsY, 40, 40};
     if (DrawSpriteButton(muteButton, (state.muted ? state.sprites.mute : state.sprites.unmute), &muteHoverScale, alpha)) {
         state.muted = !state.muted;
-        SetAudioStreamVolume(state.video.audioStream, (state.muted) ? 0.0f : 1.0f);
+        if (state.videoLoaded && state.video != NULL) SetAudioStreamVolume(state.video->audioStream, (state.muted) ? 0.0f : 1.0f);
+    }
+
+    static float gridHoverScale = 1.0f;
+    Rectangle gridButton = {state.windowWidth / 2 - 20 + 120, controlsY, 40, 40};
+    if (DrawSpriteButton(gridButton, state.sprites.palette, &gridHoverScale, alpha) && alpha > 0.9f) {
+        if (state.paletteGrid.enabled) ClosePaletteGrid();
+        else state.paletteGrid.enabled = true;
     }
 }
 
@@ -822,7 +1504,7 @@ void DrawPalettesScreen() {
         float y = listY + i * itemHeight + state.scrollOffset;
         Rectangle itemRect = {listBounds.x, y, listBounds.width, itemHeight};
 
-        bool isHovered = CheckCollisionPointRec(GetMousePosition(), itemRect);
+        bool isHovered = CheckCollisionPointRec(GetAppMousePosition(), itemRect);
 
         // Background
         if (state.colorPalettes[i].selected) {
@@ -865,13 +1547,8 @@ void DrawPalettesScreen() {
         DrawText(state.colorPalettes[i].name, (int)itemRect.x + 50, (int)itemRect.y + 15, 20, ColorAlpha(BLACK, alpha));
 
         // Handle clicks (only when fully faded in)
-        if (alpha > 0.9f && isHovered && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
-            if (!state.colorPalettes[i].selected) {
-                if (state.flipColors) SetNewColors(&state.ditherShader, state.colorPalettes[i].darkColor, state.colorPalettes[i].lightColor);
-                else SetNewColors(&state.ditherShader, state.colorPalettes[i].lightColor, state.colorPalettes[i].darkColor);
-                SetNewColors(&state.videoShader, state.colorPalettes[i].lightColor, state.colorPalettes[i].darkColor);
-                state.colorIndex = i;
-            }
+        if (alpha > 0.9f && isHovered && IsAppMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+            if (!state.colorPalettes[i].selected) SelectPalette(i);
         }
 
         if (state.colorIndex != i) {
@@ -888,20 +1565,29 @@ void DrawPalettesScreen() {
         TransitionToScreen(SCREEN_START);
     }
 
+    static float scaleHoverScale = 1.0f;
+    Rectangle scaleButton = {state.windowWidth / 2 - 100, state.windowHeight - 80, 200, 50};
+    const char* scaleText = (state.pixelScaleSetting == PIXEL_SCALE_AUTO) ? "Pixels: Auto" : FrameTextFormat("Pixels: %dx", state.pixelScaleSetting);
+    if (DrawButton(scaleButton, scaleText, &scaleHoverScale, alpha) && alpha > 0.9f && !state.transitioning) {
+        // Not now, the render target is bound and this frame's layout is half done
+        state.pixelScaleSetting = (state.pixelScaleSetting + 1) % (PIXEL_SCALE_MAX + 1);
+        state.pixelScaleChanged = true;
+    }
+
     static float flipHoverScale = 1.0f;
     Rectangle flipButton = {20, state.windowHeight - 80, 200, 50};
     if (DrawButton(flipButton, (!state.flipColors) ? "Light Mode" : "Dark Mode", &flipHoverScale, alpha) && alpha > 0.9f) {
         state.flipColors = !state.flipColors;
         if (state.flipColors) {
-            SetNewColors(&state.ditherShader, state.colorPalettes[state.colorIndex].darkColor, state.colorPalettes[state.colorIndex].lightColor);
+            SetNewColors(&state.uiUniforms, state.colorPalettes[state.colorIndex].darkColor, state.colorPalettes[state.colorIndex].lightColor);
         }
         else {
-            SetNewColors(&state.ditherShader, state.colorPalettes[state.colorIndex].lightColor, state.colorPalettes[state.colorIndex].darkColor);
+            SetNewColors(&state.uiUniforms, state.colorPalettes[state.colorIndex].lightColor, state.colorPalettes[state.colorIndex].darkColor);
         }
     }
 
     // Scroll handling
-    float mouseWheel = GetMouseWheelMove();
+    float mouseWheel = GetAppMouseWheelMove();
     if (mouseWheel != 0) {
         state.targetScrollOffset += mouseWheel * 30;
         state.targetScrollOffset = fmaxf(state.targetScrollOffset,
@@ -961,47 +1647,329 @@ void RenderApp() {
     EndTextureMode();
 
     if (state.videoLoaded && (state.currentScreen == SCREEN_VIEWING || state.targetScreen == SCREEN_VIEWING)) {
-        BeginTextureMode(state.videoTarget);
-        BeginShaderMode(state.videoShader);
-        DrawTexturePro(state.video.videoTexture,
-                       (Rectangle){0, 0, (float)state.video.videoTexture.width, (float)state.video.videoTexture.height},
-                       state.videoDisplayRect, (Vector2){0, 0}, 0, WHITE);
-        EndShaderMode();
+        Texture2D videoTexture = GetVideoTexture();
+        Rectangle videoSource = {0, 0, (float)videoTexture.width, (float)videoTexture.height};
+        PaletteGrid* grid = &state.paletteGrid;
+        if (grid->enabled) UpdatePaletteGridTarget();
+
+        if (grid->enabled && grid->maskTarget.id != 0) {
+            // The dither levels don't care about colors, so the frame is only dithered once...
+            float maskOrigin[2] = {0, (float)(grid->maskTarget.texture.height - grid->cellHeight)};
+            SetUniformBlockValue(&state.maskUniforms, &state.ditherProgram, DITHER_PATTERN_ORIGIN, maskOrigin);
+            BeginTextureMode(grid->maskTarget);
+            ClearBackground(BLANK);
+            BeginShaderProgram(&state.ditherProgram, &state.maskUniforms);
+            DrawTexturePro(videoTexture, videoSource, (Rectangle){0, 0, grid->cellWidth, grid->cellHeight}, (Vector2){0, 0}, 0, WHITE);
+            EndShaderProgram();
+            EndTextureMode();
+
+            // ...and every palette is just a lookup on top of it, all cells in one batch
+            BeginTextureMode(state.videoTarget);
+            ClearBackground(BLANK);
+            BeginShaderProgram(&state.paletteProgram, NULL);
+            SetShaderValueTexture(state.paletteProgram.shader, state.paletteProgram.locs[0], state.paletteTexture);
+            Rectangle maskSource = RenderTargetSourceRect(grid->maskTarget, grid->cellWidth, grid->cellHeight);
+            for (int i = 0; i < state.colorCount; i++) {
+                DrawTexturePro(grid->maskTarget.texture, maskSource, GetPaletteGridCell(i), (Vector2){0, 0}, 0, (Color){(unsigned char)i, 0, 0, 255});
+            }
+            EndShaderProgram();
+            EndTextureMode();
+        } else {
+            BeginTextureMode(state.videoTarget);
+            ClearBackground(BLANK);
+            BeginShaderProgram(&state.ditherProgram, &state.videoUniforms);
+            DrawTexturePro(videoTexture, videoSource, state.videoDisplayRect, (Vector2){0, 0}, 0, WHITE);
+            EndShaderProgram();
+            EndTextureMode();
+        }
+
+        if (state.showSyncStats) {
+            BeginTextureMode(state.videoTarget);
+            DrawSyncStats();
+            EndTextureMode();
+        }
+    }
+
+    // Scaled up, the UI is dithered at layout size first, the blit to the screen is then just a copy
+    RenderTexture2D uiSource = state.renderTarget;
+    if (state.pixelScale > 1) {
+        BeginTextureMode(state.uiTarget);
+        BeginShaderProgram(&state.ditherProgram, &state.uiUniforms);
+        DrawTexturePro(state.renderTarget.texture,
+                       RenderTargetSourceRect(state.renderTarget, state.windowWidth, state.windowHeight),
+                       (Rectangle){0, 0, state.windowWidth, state.windowHeight}, (Vector2){0, 0}, 0, WHITE);
+        EndShaderProgram();
         EndTextureMode();
+        uiSource = state.uiTarget;
     }
 
-    BeginDrawing();
-    BeginShaderMode(state.ditherShader);
-    DrawTextureRec(state.renderTarget.texture,
-                   (Rectangle){0, 0, state.renderTarget.texture.width, -state.renderTarget.texture.height},
-                   (Vector2){0, 0}, WHITE);
-    EndShaderMode();
+    if (IsHeadless()) BeginTextureMode(state.screenTarget);
+    else BeginDrawing();
+    // Render targets are point-filtered, so this is a plain integer nearest-neighbor upscale
+    Rectangle screenRect = {0, 0, state.windowWidth * state.pixelScale, state.windowHeight * state.pixelScale};
+    if (state.pixelScale == 1) BeginShaderProgram(&state.ditherProgram, &state.uiUniforms);
+    DrawTexturePro(uiSource.texture,
+                   RenderTargetSourceRect(uiSource, state.windowWidth, state.windowHeight),
+                   screenRect, (Vector2){0, 0}, 0, WHITE);
+    if (state.pixelScale == 1) EndShaderProgram();
     if (state.videoLoaded && (state.currentScreen == SCREEN_VIEWING || state.targetScreen == SCREEN_VIEWING))
-        DrawTextureRec(state.videoTarget.texture, (Rectangle){0, 0, state.videoTarget.texture.width, -state.videoTarget.texture.height}, (Vector2){0, 0}, ColorAlpha(WHITE, videoAlpha));
-    EndDrawing();
+        DrawTexturePro(state.videoTarget.texture, RenderTargetSourceRect(state.videoTarget, state.windowWidth, state.windowHeight), screenRect, (Vector2){0, 0}, 0, ColorAlpha(WHITE, videoAlpha));
+    if (IsHeadless()) EndTextureMode();
+    else EndDrawing();
+}
+
+
+// flipfilter --pipe [--in rgba|rgb24|yuv420p|container] [--out rgba|rgb24|yuv420p|container] [--size WxH]
+//            [--rate FPS] [--palette N] [--flip] [--codec NAME] [--muxer NAME] [--threads N]
+// Container output is ffv1 in nut unless --codec/--muxer say otherwise.
+// Returns false if the arguments don't make sense (already logged).
+bool ParsePipeArgs(int argc, char** argv, PipeOptions* options) {
+    int paletteIndex = 0;
+    bool flip = false;
+
+    *options = (PipeOptions){0};
+    options->inputFormat = PIPE_FORMAT_RGBA;
+    options->outputFormat = PIPE_FORMAT_RGBA;
+    // Lossless and streamable, so container output works through a pipe without picking anything
+    options->codec = "ffv1";
+    options->muxer = "nut";
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        bool ok = true;
+
+        if (strcmp(arg, "--pipe") == 0) continue;
+        if (strcmp(arg, "--flip") == 0) {
+            flip = true;
+            continue;
+        }
+        if (value == NULL) {
+            TraceLog(LOG_ERROR, "Pipe: %s needs a value", arg);
+            return false;
+        }
+
+        if (strcmp(arg, "--in") == 0) ok = ParsePipeFormat(value, &options->inputFormat);
+        else if (strcmp(arg, "--out") == 0) ok = ParsePipeFormat(value, &options->outputFormat);
+        else if (strcmp(arg, "--size") == 0) ok = sscanf(value, "%dx%d", &options->width, &options->height) == 2;
+        else if (strcmp(arg, "--rate") == 0) options->frameRate = atof(value);
+        else if (strcmp(arg, "--palette") == 0) ok = (paletteIndex = atoi(value)) >= 0 && paletteIndex < state.colorCount;
+        else if (strcmp(arg, "--codec") == 0) options->codec = value;
+        else if (strcmp(arg, "--muxer") == 0) options->muxer = value;
+        else if (strcmp(arg, "--threads") == 0) options->threads = atoi(value);
+        else {
+            TraceLog(LOG_ERROR, "Pipe: unknown option %s", arg);
+            return false;
+        }
+
+        if (!ok) {
+            TraceLog(LOG_ERROR, "Pipe: bad value for %s: %s", arg, value);
+            return false;
+        }
+        i++;
+    }
+
+    // Flip does the same swap dark mode does in the UI
+    Palette palette = state.colorPalettes[paletteIndex];
+    options->lightColor = flip ? palette.darkColor : palette.lightColor;
+    options->darkColor = flip ? palette.lightColor : palette.darkColor;
+    return true;
+}
+
+
+// flipfilter --export INPUT OUTPUT [--size WxH] [--palette N] [--flip] [--threads N]
+// Format comes from OUTPUT's extension (.gif, .png/.apng, .webp).
+int RunExportCommand(int argc, char** argv) {
+    if (argc < 4) {
+        TraceLog(LOG_ERROR, "Export: usage: --export INPUT OUTPUT [--size WxH] [--palette N] [--flip] [--threads N]");
+        return 2;
+    }
+
+    const char* inputPath = argv[2];
+    const char* outputPath = argv[3];
+    ExportOptions options = {0};
+    if (!GetExportFormat(outputPath, &options.format)) {
+        TraceLog(LOG_ERROR, "Export: %s isn't a .gif, .png or .webp", outputPath);
+        return 2;
+    }
+
+    int paletteIndex = 0;
+    bool flip = false;
+    for (int i = 4; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--flip") == 0) {
+            flip = true;
+            continue;
+        }
+
+        bool ok = (value != NULL);
+        if (ok && strcmp(arg, "--size") == 0) ok = sscanf(value, "%dx%d", &options.width, &options.height) == 2;
+        else if (ok && strcmp(arg, "--palette") == 0) ok = (paletteIndex = atoi(value)) >= 0 && paletteIndex < state.colorCount;
+        else if (ok && strcmp(arg, "--threads") == 0) options.threads = atoi(value);
+        else ok = false;
+
+        if (!ok) {
+            TraceLog(LOG_ERROR, "Export: bad option %s", arg);
+            return 2;
+        }
+        i++;
+    }
+
+    Palette palette = state.colorPalettes[paletteIndex];
+    options.lightColor = flip ? palette.darkColor : palette.lightColor;
+    options.darkColor = flip ? palette.lightColor : palette.darkColor;
+    return ExportAnimation(inputPath, outputPath, &options) ? 0 : 1;
+}
+
+
+// Screen names for headless frame stats, in ScreenState order
+static const char* screenNames[] = {"palettes", "start", "explorer", "viewing"};
+static const char* transitionNames[] = {"to palettes", "to start", "to explorer", "to viewing"};
+
+
+// A video that's been playing for a frame or two, nothing in the frame loop should be allocating by now.
+bool IsSteadyPlayback() {
+    return state.currentScreen == SCREEN_VIEWING && !state.transitioning && state.videoLoaded && state.playbackFrames > 1;
+}
+
+
+void CloseApp() {
+    UnloadExportQueue();
+    CloseCachedPlayback();
+    UnloadFrameCache();
+    UnloadLibraryIndex();
+    AppFree(state.searchResults);
+    UnloadMediaPool();
+    AppFree(state.files);
+    UnloadStringPool(&state.fileStrings);
+    ReleaseRenderTarget(state.renderTarget);
+    ReleaseRenderTarget(state.uiTarget);
+    ReleaseRenderTarget(state.videoTarget);
+    ClosePaletteGrid();
+    UnloadRenderTargetPool();
+    if (state.screenTarget.id != 0) UnloadRenderTexture(state.screenTarget);
+    UnloadShaderProgram(&state.ditherProgram);
+    UnloadShaderProgram(&state.paletteProgram);
+    UnloadTexture(state.paletteTexture);
+    UnloadTexture(state.circleTexture);
+    UnloadShaderManager();
+    AppFree(state.colorPalettes);
+    CloseWindow();
+    UnloadAppMemory();
 }
 
 
-int main() {
+// flipfilter --headless SCRIPT [--out DIR] [--fps N] [--dump-every N] [--dir PATH]
+// Runs the whole app against a script on a fixed clock, as fast as it'll go, and writes frame costs to DIR/frames.csv.
+// Frames go to DIR/frame_NNNNN.png every N frames and wherever the script says dump.
+int RunHeadless(int argc, char** argv) {
+    if (argc < 3) {
+        TraceLog(LOG_ERROR, "Headless: usage: --headless SCRIPT [--out DIR] [--fps N] [--dump-every N] [--dir PATH]");
+        return 2;
+    }
+
+    const char* outputDir = "headless";
+    const char* startDir = NULL;
+    float fps = 60.0f;
+    int dumpEvery = 0;
+    for (int i = 3; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        bool ok = (value != NULL);
+        if (ok && strcmp(arg, "--out") == 0) outputDir = value;
+        else if (ok && strcmp(arg, "--dir") == 0) startDir = value;
+        else if (ok && strcmp(arg, "--fps") == 0) ok = (fps = (float)atof(value)) > 0;
+        else if (ok && strcmp(arg, "--dump-every") == 0) ok = (dumpEvery = atoi(value)) >= 0;
+        else ok = false;
+
+        if (!ok) {
+            TraceLog(LOG_ERROR, "Headless: bad option %s", arg);
+            return 2;
+        }
+        i++;
+    }
+
+    if (!BeginHeadless(argv[2], 1.0f / fps, 1280, 720)) {
+        TraceLog(LOG_ERROR, "Headless: couldn't load script %s", argv[2]);
+        return 1;
+    }
     InitApp();
+    if (startDir != NULL) LoadDirectory(startDir);
+    MakeDirectory(outputDir);
 
-    while (!WindowShouldClose()) {
+    while (UpdateHeadless()) {
+        int frame = GetHeadlessFrame();
+
+        double startTime = GetTime();
+        BeginAppFrame();
         UpdateApp();
+        double updateTime = GetTime();
         RenderApp();
+        // Otherwise this only times handing the commands over, the GPU work would land in whichever frame dumps a PNG
+        WaitForGpu();
+        double renderTime = GetTime();
+
+        if ((dumpEvery > 0 && frame % dumpEvery == 0) || IsHeadlessDumpRequested()) {
+            Image image = LoadImageFromTexture(state.screenTarget.texture);
+            ImageFlipVertical(&image);
+            ExportImage(image, TextFormat("%s/frame_%05d.png", outputDir, frame));
+            UnloadImage(image);
+        }
+        double dumpTime = GetTime();
+        EndAppFrame(IsSteadyPlayback());
+
+        const char* label = (state.transitioning) ? transitionNames[state.targetScreen] : screenNames[state.currentScreen];
+        RecordHeadlessFrame(label, (updateTime - startTime) * 1000.0, (renderTime - updateTime) * 1000.0, (dumpTime - renderTime) * 1000.0);
     }
 
-    if (state.videoLoaded) {
-        UnloadMedia(&state.video);
+    EndHeadless(TextFormat("%s/frames.csv", outputDir));
+    CloseApp();
+    return 0;
+}
+
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--headless") == 0) return RunHeadless(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--export") == 0) {
+        InitPalettes();
+        return RunExportCommand(argc, argv);
+    }
+
+    // Pipe mode never opens a window, so it has to be decided before InitApp
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--pipe") == 0) {
+            PipeOptions options;
+            InitPipeMode();
+            InitPalettes();
+            if (!ParsePipeArgs(argc, argv, &options)) return 2;
+            return RunPipeMode(&options);
+        }
     }
-    if (state.files != NULL) {
-        free(state.files);
+
+    // --frame-cache-mb sets the frame cache size (by default it's sized from the free disk space, 0 turns it off), --sync drop|keyframe|hold picks what gives when decoding falls behind,
+    // --library PATH (any number of them) sets the folders search covers
+    state.frameCacheMB = FRAME_CACHE_AUTO;
+    state.syncPolicy = SYNC_POLICY_DROP;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--frame-cache-mb") == 0) state.frameCacheMB = atoi(argv[i + 1]);
+        if (strcmp(argv[i], "--library") == 0 && state.libraryRootCount < LIBRARY_MAX_ROOTS) state.libraryRoots[state.libraryRootCount++] = argv[i + 1];
+        if (strcmp(argv[i], "--sync") == 0 && !ParseSyncPolicy(argv[i + 1], &state.syncPolicy)) {
+            TraceLog(LOG_WARNING, "Unknown sync policy %s, dropping late frames", argv[i + 1]);
+        }
     }
-    // There's some cleanup probably missing here, sorry.
-    // Closing the application covers most of our bases anyway :P
-    UnloadRenderTexture(state.renderTarget);
-    UnloadRenderTexture(state.videoTarget);
-    UnloadShader(state.ditherShader);
-    CloseWindow();
+
+    InitApp();
+
+    while (!WindowShouldClose()) {
+        BeginAppFrame();
+        UpdateApp();
+        RenderApp();
+        EndAppFrame(IsSteadyPlayback());
+    }
+
+    CloseApp();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "mediapool.h"
+#include <stdio.h>
+#include <string.h>
+
+static struct {
+    MediaSession sessions[MEDIA_POOL_SIZE];
+    MediaSession* active;
+    unsigned int clock;
+
+    // Prefetch waiting to be opened at the start of the next frame
+    char prefetchPath[512];
+    int prefetchFlags;
+    bool prefetchPending;
+} pool = {0};
+
+
+static MediaSession* FindSession(const char* path, int flags) {
+    for (int i = 0; i < MEDIA_POOL_SIZE; i++) {
+        MediaSession* session = &pool.sessions[i];
+        if (session->loaded && session->flags == flags && strcmp(session->path, path) == 0) return session;
+    }
+    return NULL;
+}
+
+
+static void Silence(MediaSession* session) {
+    if (GetMediaState(session->media) == MEDIA_STATE_PLAYING) SetMediaState(session->media, MEDIA_STATE_PAUSED);
+    SetAudioStreamVolume(session->media.audioStream, 0.0f);
+}
+
+
+// Loads path into the least recently used slot, never touching the active session.
+static MediaSession* OpenSession(const char* path, int flags) {
+    MediaSession* slot = NULL;
+    for (int i = 0; i < MEDIA_POOL_SIZE; i++) {
+        MediaSession* session = &pool.sessions[i];
+        if (session == pool.active) continue;
+        if (!session->loaded) {
+            slot = session;
+            break;
+        }
+        if (slot == NULL || session->lastUsed < slot->lastUsed) slot = session;
+    }
+
+    if (slot->loaded) {
+        TraceLog(LOG_DEBUG, "Media pool: evicting %s", slot->path);
+        UnloadMedia(&slot->media);
+        slot->loaded = false;
+    }
+
+    MediaStream media = LoadMediaEx(path, flags);
+    if (!IsMediaValid(media)) {
+        TraceLog(LOG_WARNING, "Media pool: couldn't open %s", path);
+        return NULL;
+    }
+
+    snprintf(slot->path, sizeof(slot->path), "%s", path);
+    slot->flags = flags;
+    slot->media = media;
+    slot->loaded = true;
+    slot->lastUsed = ++pool.clock;
+
+    // Whoever asked decides when it starts playing
+    Silence(slot);
+    return slot;
+}
+
+
+MediaStream* AcquireMediaSession(const char* path, int flags) {
+    MediaSession* session = FindSession(path, flags);
+    if (session == NULL) {
+        if (pool.prefetchPending && pool.prefetchFlags == flags && strcmp(pool.prefetchPath, path) == 0) pool.prefetchPending = false;
+        session = OpenSession(path, flags);
+    }
+    if (session == NULL) return NULL;
+
+    if (pool.active != NULL && pool.active != session) Silence(pool.active);
+    pool.active = session;
+    session->lastUsed = ++pool.clock;
+
+    return &session->media;
+}
+
+
+void PrefetchMediaSession(const char* path, int flags) {
+    MediaSession* session = FindSession(path, flags);
+    if (session != NULL) {
+        session->lastUsed = ++pool.clock;
+        return;
+    }
+
+    snprintf(pool.prefetchPath, sizeof(pool.prefetchPath), "%s", path);
+    pool.prefetchFlags = flags;
+    pool.prefetchPending = true;
+}
+
+
+void UpdateMediaPool(void) {
+    if (!pool.prefetchPending) return;
+
+    // LoadMediaEx opens the file and the codec and creates the texture and audio stream in one go,
+    // so all of it has to happen here on the main thread
+    pool.prefetchPending = false;
+    if (FindSession(pool.prefetchPath, pool.prefetchFlags) != NULL) return;
+    MediaSession* session = OpenSession(pool.prefetchPath, pool.prefetchFlags);
+    if (session != NULL) session->lastUsed = ++pool.clock;
+}
+
+
+void PauseActiveMediaSession(void) {
+    if (pool.active != NULL) Silence(pool.active);
+}
+
+
+void UnloadMediaPool(void) {
+    pool.prefetchPending = false;
+    for (int i = 0; i < MEDIA_POOL_SIZE; i++) {
+        if (pool.sessions[i].loaded) UnloadMedia(&pool.sessions[i].media);
+        pool.sessions[i].loaded = false;
+    }
+    pool.active = NULL;
+}
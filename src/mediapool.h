@@ -0,0 +1,35 @@
+#ifndef MEDIAPOOL_H
+#define MEDIAPOOL_H
+
+#include "raylib.h"
+#include "raymedia.h"
+
+// How many media files are kept open (demuxer, decoder and the last decoded frame).
+#define MEDIA_POOL_SIZE 4
+
+typedef struct {
+    char path[512];
+    int flags;  // MEDIA_LOAD_* it was opened with, the same file opened differently is a different session
+    MediaStream media;
+    unsigned int lastUsed;
+    bool loaded;
+} MediaSession;
+
+// Opens path (with LoadMediaEx flags), or reuses the already open session for it, and makes it the active one.
+// The previously active session is paused and silenced but stays open.
+// The returned stream stays valid until another session is acquired. Returns NULL if the file couldn't be opened.
+MediaStream* AcquireMediaSession(const char* path, int flags);
+
+// Gets path ready (paused, silent) so a later Acquire is instant.
+// The session is opened by the next UpdateMediaPool, on the main thread since it needs the GL context,
+// so the caller isn't held up but that frame is. Only the latest prefetch counts.
+void PrefetchMediaSession(const char* path, int flags);
+// Call once a frame, finishes prefetches.
+void UpdateMediaPool(void);
+
+// Pauses and silences the active session, it stays open and active.
+void PauseActiveMediaSession(void);
+
+void UnloadMediaPool(void);
+
+#endif
@@ -0,0 +1,22 @@
+#version 330
+
+// Colors a black and white mask from dither.fs with one of the palettes.
+// The palette index rides along in the vertex color's red channel, so every cell of the grid
+// is one quad in the same batch, with paletteColors holding light colors in row 0 and dark colors in row 1.
+
+in vec2 fragTexCoord;
+in vec4 fragColor;
+
+uniform sampler2D texture0;
+uniform sampler2D paletteColors;
+
+out vec4 finalColor;
+
+void main() {
+    vec4 mask = texture(texture0, fragTexCoord);
+    int index = int(fragColor.r * 255.0 + 0.5);
+
+    vec3 lightColor = texelFetch(paletteColors, ivec2(index, 0), 0).rgb;
+    vec3 darkColor = texelFetch(paletteColors, ivec2(index, 1), 0).rgb;
+    finalColor = vec4((mask.r > 0.5) ? lightColor : darkColor, mask.a);
+}
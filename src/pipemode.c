@@ -0,0 +1,660 @@
+#include "pipemode.h"
+#include "ditherkernel.h"
+#include "videodecoder.h"
+#include "platform.h"
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <pthread.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Double buffered on both ends: while one frame is being dithered, the next is being read and the last is being written.
+#define PIPE_RING_SIZE 2
+#define PIPE_MAX_THREADS 16
+
+typedef struct {
+    unsigned char* data[3];
+    int stride[3];
+} PipeImage;
+
+// Hands slot indices from one thread to the next. Slots are only ever touched by whoever holds them.
+typedef struct {
+    int head;
+    int count;
+    bool closed;   // Producer is done, the reader drains what's left
+    bool aborted;  // Something failed, everyone stops
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} FrameRing;
+
+typedef struct PipeContext PipeContext;
+
+typedef struct {
+    pthread_t thread;
+    PipeContext* context;
+    int index;
+    unsigned char* mask;  // Two rows of scratch, yuv420p output needs a pair at a time
+} BandWorker;
+
+struct PipeContext {
+    PipeOptions options;
+    int width;
+    int height;
+    double frameRate;
+    PipeFormat inputLayout;   // What the input slots hold (container input is decoded to yuv420p)
+    PipeFormat outputLayout;  // What the output slots hold (container output picks what the encoder takes)
+
+    size_t inputFrameSize;
+    size_t outputFrameSize;
+    unsigned char* inputBuffer;
+    unsigned char* outputBuffer;
+    PipeImage inputs[PIPE_RING_SIZE];
+    PipeImage outputs[PIPE_RING_SIZE];
+    FrameRing inputRing;
+    FrameRing outputRing;
+
+    VideoDecoder* decoder;
+
+    AVFormatContext* muxer;
+    AVCodecContext* encoder;
+    AVStream* stream;
+    AVFrame* outputFrames[PIPE_RING_SIZE];
+    AVPacket* packet;
+    long long encodedFrames;
+
+    // Palette in every form the outputs need
+    unsigned char light[4];
+    unsigned char dark[4];
+    unsigned char lightY, darkY;
+    unsigned char chromaU[5];  // By number of light pixels in a 2x2 block
+    unsigned char chromaV[5];
+
+    BandWorker workers[PIPE_MAX_THREADS];
+    int workerCount;
+    pthread_mutex_t bandLock;
+    pthread_cond_t bandStart;
+    pthread_cond_t bandDone;
+    unsigned int bandGeneration;
+    int bandsPending;
+    int bandInput;
+    int bandOutput;
+    bool quit;
+
+    bool failed;
+    long long frames;
+};
+
+
+bool ParsePipeFormat(const char* name, PipeFormat* format) {
+    if (strcmp(name, "rgba") == 0) *format = PIPE_FORMAT_RGBA;
+    else if (strcmp(name, "rgb24") == 0) *format = PIPE_FORMAT_RGB24;
+    else if (strcmp(name, "yuv420p") == 0) *format = PIPE_FORMAT_YUV420P;
+    else if (strcmp(name, "container") == 0) *format = PIPE_FORMAT_CONTAINER;
+    else return false;
+    return true;
+}
+
+
+static void LogToStderr(int logLevel, const char* text, va_list args) {
+    // stdout is the video, so logs have to go somewhere else
+    static const char* levels[] = {"", "TRACE", "DEBUG", "INFO", "WARNING", "ERROR", "FATAL", ""};
+    fprintf(stderr, "%s: ", levels[(logLevel >= 0 && logLevel <= 7) ? logLevel : 0]);
+    vfprintf(stderr, text, args);
+    fputc('\n', stderr);
+}
+
+
+static void InitRing(FrameRing* ring) {
+    memset(ring, 0, sizeof(*ring));
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->changed, NULL);
+}
+
+
+static void DestroyRing(FrameRing* ring) {
+    pthread_mutex_destroy(&ring->lock);
+    pthread_cond_destroy(&ring->changed);
+}
+
+
+// Waits for a free slot, -1 if the pipeline was aborted.
+static int BeginRingWrite(FrameRing* ring) {
+    pthread_mutex_lock(&ring->lock);
+    while (ring->count == PIPE_RING_SIZE && !ring->aborted) pthread_cond_wait(&ring->changed, &ring->lock);
+    int slot = ring->aborted ? -1 : (ring->head + ring->count) % PIPE_RING_SIZE;
+    pthread_mutex_unlock(&ring->lock);
+    return slot;
+}
+
+
+static void EndRingWrite(FrameRing* ring) {
+    pthread_mutex_lock(&ring->lock);
+    ring->count++;
+    pthread_cond_broadcast(&ring->changed);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+
+// Waits for a filled slot, -1 once the ring is closed and empty (or aborted).
+static int BeginRingRead(FrameRing* ring) {
+    pthread_mutex_lock(&ring->lock);
+    while (ring->count == 0 && !ring->closed && !ring->aborted) pthread_cond_wait(&ring->changed, &ring->lock);
+    int slot = (ring->count > 0 && !ring->aborted) ? ring->head : -1;
+    pthread_mutex_unlock(&ring->lock);
+    return slot;
+}
+
+
+static void EndRingRead(FrameRing* ring) {
+    pthread_mutex_lock(&ring->lock);
+    ring->head = (ring->head + 1) % PIPE_RING_SIZE;
+    ring->count--;
+    pthread_cond_broadcast(&ring->changed);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+
+static void CloseRing(FrameRing* ring, bool aborted) {
+    pthread_mutex_lock(&ring->lock);
+    ring->closed = true;
+    if (aborted) ring->aborted = true;
+    pthread_cond_broadcast(&ring->changed);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+
+static size_t FrameSize(PipeFormat layout, int width, int height) {
+    switch (layout) {
+        case PIPE_FORMAT_RGBA: return (size_t)width * height * 4;
+        case PIPE_FORMAT_RGB24: return (size_t)width * height * 3;
+        default: return (size_t)width * height + 2 * (size_t)((width + 1) / 2) * ((height + 1) / 2);
+    }
+}
+
+
+static void SetImagePlanes(PipeImage* image, unsigned char* base, PipeFormat layout, int width, int height) {
+    memset(image, 0, sizeof(*image));
+    image->data[0] = base;
+    switch (layout) {
+        case PIPE_FORMAT_RGBA:
+            image->stride[0] = width * 4;
+            break;
+        case PIPE_FORMAT_RGB24:
+            image->stride[0] = width * 3;
+            break;
+        default:
+            image->stride[0] = width;
+            image->stride[1] = image->stride[2] = (width + 1) / 2;
+            image->data[1] = base + (size_t)width * height;
+            image->data[2] = image->data[1] + (size_t)image->stride[1] * ((height + 1) / 2);
+            break;
+    }
+}
+
+
+static void SetPalette(PipeContext* context, Color light, Color dark) {
+    Color colors[2] = {dark, light};
+    unsigned char y[2], u[2], v[2];
+    for (int i = 0; i < 2; i++) {
+        // BT.601 limited range, what yuv420p consumers expect by default
+        int r = colors[i].r, g = colors[i].g, b = colors[i].b;
+        y[i] = (unsigned char)(((66*r + 129*g + 25*b + 128) >> 8) + 16);
+        u[i] = (unsigned char)(((-38*r - 74*g + 112*b + 128) >> 8) + 128);
+        v[i] = (unsigned char)(((112*r - 94*g - 18*b + 128) >> 8) + 128);
+    }
+
+    memcpy(context->light, &light, 4);
+    memcpy(context->dark, &dark, 4);
+    context->lightY = y[1];
+    context->darkY = y[0];
+    for (int n = 0; n <= 4; n++) {
+        context->chromaU[n] = (unsigned char)((n*u[1] + (4 - n)*u[0] + 2) / 4);
+        context->chromaV[n] = (unsigned char)((n*v[1] + (4 - n)*v[0] + 2) / 4);
+    }
+}
+
+
+static void DitherInputRow(const PipeContext* context, const PipeImage* input, int row, unsigned char* mask) {
+    int patternY = context->height - 1 - row;
+    switch (context->inputLayout) {
+        case PIPE_FORMAT_RGBA:
+            DitherRowRGBA(input->data[0] + (size_t)row * input->stride[0], mask, context->width, patternY);
+            break;
+        case PIPE_FORMAT_RGB24:
+            DitherRowRGB(input->data[0] + (size_t)row * input->stride[0], mask, context->width, patternY);
+            break;
+        default:
+            DitherRowYUV(input->data[0] + (size_t)row * input->stride[0],
+                         input->data[1] + (size_t)(row / 2) * input->stride[1],
+                         input->data[2] + (size_t)(row / 2) * input->stride[2],
+                         mask, context->width, patternY);
+            break;
+    }
+}
+
+
+static void DitherBand(PipeContext* context, const PipeImage* input, PipeImage* output, int rowStart, int rowEnd, unsigned char* mask) {
+    int width = context->width;
+
+    for (int row = rowStart; row < rowEnd; row++) {
+        // Bands start on even rows, so for odd rows the other half of the scratch holds the row above
+        unsigned char* maskRow = mask + (row & 1) * width;
+        DitherInputRow(context, input, row, maskRow);
+
+        unsigned char* out = output->data[0] + (size_t)row * output->stride[0];
+        switch (context->outputLayout) {
+            case PIPE_FORMAT_RGBA: {
+                const unsigned char* alpha = (context->inputLayout == PIPE_FORMAT_RGBA) ? input->data[0] + (size_t)row * input->stride[0] + 3 : NULL;
+                for (int x = 0; x < width; x++) {
+                    memcpy(out + 4*x, maskRow[x] ? context->light : context->dark, 3);
+                    out[4*x + 3] = alpha ? alpha[4*x] : 255;
+                }
+            } break;
+            case PIPE_FORMAT_RGB24: {
+                for (int x = 0; x < width; x++) memcpy(out + 3*x, maskRow[x] ? context->light : context->dark, 3);
+            } break;
+            default: {
+                for (int x = 0; x < width; x++) out[x] = maskRow[x] ? context->lightY : context->darkY;
+
+                // Chroma once both rows of a pair are known (or on a lone last row)
+                if ((row & 1) || row == context->height - 1) {
+                    const unsigned char* top = mask;
+                    const unsigned char* bottom = mask + (row & 1) * width;
+                    unsigned char* u = output->data[1] + (size_t)(row / 2) * output->stride[1];
+                    unsigned char* v = output->data[2] + (size_t)(row / 2) * output->stride[2];
+                    for (int cx = 0; cx < (width + 1) / 2; cx++) {
+                        int left = 2*cx;
+                        int right = (left + 1 < width) ? left + 1 : left;
+                        int lit = top[left] + top[right] + bottom[left] + bottom[right];
+                        u[cx] = context->chromaU[lit];
+                        v[cx] = context->chromaV[lit];
+                    }
+                }
+            } break;
+        }
+    }
+}
+
+
+static void GetBand(const PipeContext* context, int index, int* rowStart, int* rowEnd) {
+    // Even sized bands so yuv420p row pairs never straddle two threads
+    int rowsPerBand = ((context->height + context->workerCount - 1) / context->workerCount + 1) & ~1;
+    *rowStart = index * rowsPerBand;
+    *rowEnd = *rowStart + rowsPerBand;
+    if (*rowStart > context->height) *rowStart = context->height;
+    if (*rowEnd > context->height) *rowEnd = context->height;
+}
+
+
+static void* BandWorkerMain(void* arg) {
+    BandWorker* worker = (BandWorker*)arg;
+    PipeContext* context = worker->context;
+    unsigned int seenGeneration = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&context->bandLock);
+        while (context->bandGeneration == seenGeneration && !context->quit) pthread_cond_wait(&context->bandStart, &context->bandLock);
+        if (context->quit) {
+            pthread_mutex_unlock(&context->bandLock);
+            break;
+        }
+        seenGeneration = context->bandGeneration;
+        pthread_mutex_unlock(&context->bandLock);
+
+        int rowStart, rowEnd;
+        GetBand(context, worker->index, &rowStart, &rowEnd);
+        DitherBand(context, &context->inputs[context->bandInput], &context->outputs[context->bandOutput], rowStart, rowEnd, worker->mask);
+
+        pthread_mutex_lock(&context->bandLock);
+        if (--context->bandsPending == 0) pthread_cond_signal(&context->bandDone);
+        pthread_mutex_unlock(&context->bandLock);
+    }
+
+    return NULL;
+}
+
+
+// Splits the frame into horizontal bands, the calling thread takes the first one.
+static void DitherFrame(PipeContext* context, int inputSlot, int outputSlot) {
+    pthread_mutex_lock(&context->bandLock);
+    context->bandInput = inputSlot;
+    context->bandOutput = outputSlot;
+    context->bandsPending = context->workerCount - 1;
+    context->bandGeneration++;
+    pthread_cond_broadcast(&context->bandStart);
+    pthread_mutex_unlock(&context->bandLock);
+
+    int rowStart, rowEnd;
+    GetBand(context, 0, &rowStart, &rowEnd);
+    DitherBand(context, &context->inputs[inputSlot], &context->outputs[outputSlot], rowStart, rowEnd, context->workers[0].mask);
+
+    pthread_mutex_lock(&context->bandLock);
+    while (context->bandsPending > 0) pthread_cond_wait(&context->bandDone, &context->bandLock);
+    pthread_mutex_unlock(&context->bandLock);
+}
+
+
+static void* ReaderMain(void* arg) {
+    PipeContext* context = (PipeContext*)arg;
+
+    for (;;) {
+        int slot = BeginRingWrite(&context->inputRing);
+        if (slot < 0) break;
+
+        PipeImage* image = &context->inputs[slot];
+        bool ok;
+        if (context->decoder != NULL) {
+            ok = DecodeVideoFrame(context->decoder, image->data, image->stride, NULL);
+        } else {
+            size_t read = fread(image->data[0], 1, context->inputFrameSize, stdin);
+            if (read > 0 && read < context->inputFrameSize) TraceLog(LOG_WARNING, "Pipe: dropped a partial frame at the end of the input");
+            ok = (read == context->inputFrameSize);
+        }
+        if (!ok) break;
+
+        EndRingWrite(&context->inputRing);
+    }
+
+    CloseRing(&context->inputRing, false);
+    return NULL;
+}
+
+
+// frame == NULL flushes the encoder.
+static bool EncodeFrame(PipeContext* context, AVFrame* frame) {
+    if (frame != NULL) frame->pts = context->encodedFrames++;
+    if (avcodec_send_frame(context->encoder, frame) < 0) return false;
+
+    for (;;) {
+        int result = avcodec_receive_packet(context->encoder, context->packet);
+        if (result == AVERROR(EAGAIN) || result == AVERROR_EOF) return true;
+        if (result < 0) return false;
+
+        av_packet_rescale_ts(context->packet, context->encoder->time_base, context->stream->time_base);
+        context->packet->stream_index = context->stream->index;
+        if (av_interleaved_write_frame(context->muxer, context->packet) < 0) return false;
+    }
+}
+
+
+static void* WriterMain(void* arg) {
+    PipeContext* context = (PipeContext*)arg;
+
+    for (;;) {
+        int slot = BeginRingRead(&context->outputRing);
+        if (slot < 0) break;
+
+        bool ok;
+        if (context->encoder != NULL) {
+            ok = EncodeFrame(context, context->outputFrames[slot]);
+        } else {
+            ok = fwrite(context->outputs[slot].data[0], 1, context->outputFrameSize, stdout) == context->outputFrameSize;
+        }
+        EndRingRead(&context->outputRing);
+
+        if (!ok) {
+            TraceLog(LOG_ERROR, "Pipe: couldn't write output (downstream closed?)");
+            context->failed = true;
+            CloseRing(&context->outputRing, true);
+            CloseRing(&context->inputRing, true);
+            return NULL;
+        }
+    }
+
+    if (context->encoder != NULL) {
+        EncodeFrame(context, NULL);
+        av_write_trailer(context->muxer);
+    }
+    fflush(stdout);
+
+    return NULL;
+}
+
+
+static bool OpenEncoder(PipeContext* context) {
+    const AVCodec* codec = avcodec_find_encoder_by_name(context->options.codec);
+    if (codec == NULL) {
+        TraceLog(LOG_ERROR, "Pipe: unknown encoder %s", context->options.codec);
+        return false;
+    }
+
+    // Dither straight into whatever the encoder takes, so nothing has to be converted per frame
+    context->outputLayout = (PipeFormat)-1;
+    enum AVPixelFormat pixelFormat = AV_PIX_FMT_NONE;
+    static const enum AVPixelFormat preferred[] = {AV_PIX_FMT_YUV420P, AV_PIX_FMT_RGBA, AV_PIX_FMT_RGB24};
+    static const PipeFormat layouts[] = {PIPE_FORMAT_YUV420P, PIPE_FORMAT_RGBA, PIPE_FORMAT_RGB24};
+    for (int i = 0; i < 3 && pixelFormat == AV_PIX_FMT_NONE; i++) {
+        if (codec->pix_fmts == NULL && i == 0) pixelFormat = preferred[i];
+        for (const enum AVPixelFormat* format = codec->pix_fmts; format && *format != AV_PIX_FMT_NONE; format++) {
+            if (*format == preferred[i]) pixelFormat = preferred[i];
+        }
+        if (pixelFormat != AV_PIX_FMT_NONE) context->outputLayout = layouts[i];
+    }
+    if (pixelFormat == AV_PIX_FMT_NONE) {
+        TraceLog(LOG_ERROR, "Pipe: encoder %s takes neither yuv420p, rgba nor rgb24", codec->name);
+        return false;
+    }
+
+    if (avformat_alloc_output_context2(&context->muxer, NULL, context->options.muxer, NULL) < 0 || context->muxer == NULL) {
+        TraceLog(LOG_ERROR, "Pipe: unknown container %s", context->options.muxer);
+        return false;
+    }
+
+    context->encoder = avcodec_alloc_context3(codec);
+    context->encoder->width = context->width;
+    context->encoder->height = context->height;
+    context->encoder->pix_fmt = pixelFormat;
+    context->encoder->framerate = av_d2q(context->frameRate, 100000);
+    context->encoder->time_base = av_inv_q(context->encoder->framerate);
+    context->encoder->thread_count = 0;
+    if (context->muxer->oformat->flags & AVFMT_GLOBALHEADER) context->encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    if (avcodec_open2(context->encoder, codec, NULL) < 0) {
+        TraceLog(LOG_ERROR, "Pipe: couldn't open encoder %s", codec->name);
+        return false;
+    }
+
+    context->stream = avformat_new_stream(context->muxer, NULL);
+    avcodec_parameters_from_context(context->stream->codecpar, context->encoder);
+    context->stream->time_base = context->encoder->time_base;
+
+    if (!(context->muxer->oformat->flags & AVFMT_NOFILE) && avio_open(&context->muxer->pb, "pipe:1", AVIO_FLAG_WRITE) < 0) {
+        TraceLog(LOG_ERROR, "Pipe: couldn't open stdout for writing");
+        return false;
+    }
+    if (avformat_write_header(context->muxer, NULL) < 0) {
+        TraceLog(LOG_ERROR, "Pipe: couldn't write the %s header", context->options.muxer);
+        return false;
+    }
+
+    context->packet = av_packet_alloc();
+    for (int i = 0; i < PIPE_RING_SIZE; i++) {
+        AVFrame* frame = av_frame_alloc();
+        frame->format = pixelFormat;
+        frame->width = context->width;
+        frame->height = context->height;
+        av_frame_get_buffer(frame, 0);
+        context->outputFrames[i] = frame;
+    }
+
+    return true;
+}
+
+
+static void CloseEncoder(PipeContext* context) {
+    for (int i = 0; i < PIPE_RING_SIZE; i++) av_frame_free(&context->outputFrames[i]);
+    av_packet_free(&context->packet);
+    avcodec_free_context(&context->encoder);
+    if (context->muxer != NULL) {
+        if (!(context->muxer->oformat->flags & AVFMT_NOFILE)) avio_closep(&context->muxer->pb);
+        avformat_free_context(context->muxer);
+        context->muxer = NULL;
+    }
+}
+
+
+// The encoder may still hold a reference to a slot's frame, in which case FFmpeg hands us a fresh buffer.
+static void PrepareOutputFrame(PipeContext* context, int slot) {
+    AVFrame* frame = context->outputFrames[slot];
+    av_frame_make_writable(frame);
+
+    PipeImage* image = &context->outputs[slot];
+    for (int i = 0; i < 3; i++) {
+        image->data[i] = frame->data[i];
+        image->stride[i] = frame->linesize[i];
+    }
+}
+
+
+static bool StartWorkers(PipeContext* context) {
+    int threads = context->options.threads;
+    // Reading and writing get a core each
+    if (threads <= 0) threads = GetProcessorCount() - 2;
+    if (threads < 1) threads = 1;
+    if (threads > PIPE_MAX_THREADS) threads = PIPE_MAX_THREADS;
+    // No point in bands thinner than a couple of rows
+    if (threads > context->height / 2) threads = (context->height / 2 > 0) ? context->height / 2 : 1;
+
+    pthread_mutex_init(&context->bandLock, NULL);
+    pthread_cond_init(&context->bandStart, NULL);
+    pthread_cond_init(&context->bandDone, NULL);
+
+    context->workerCount = threads;
+    for (int i = 0; i < threads; i++) {
+        BandWorker* worker = &context->workers[i];
+        worker->context = context;
+        worker->index = i;
+        worker->mask = (unsigned char*)malloc((size_t)context->width * 2);
+        // Worker 0 is whoever calls DitherFrame
+        if (i > 0 && pthread_create(&worker->thread, NULL, BandWorkerMain, worker) != 0) return false;
+    }
+
+    return true;
+}
+
+
+static void StopWorkers(PipeContext* context) {
+    pthread_mutex_lock(&context->bandLock);
+    context->quit = true;
+    pthread_cond_broadcast(&context->bandStart);
+    pthread_mutex_unlock(&context->bandLock);
+
+    for (int i = 0; i < context->workerCount; i++) {
+        if (i > 0) pthread_join(context->workers[i].thread, NULL);
+        free(context->workers[i].mask);
+    }
+
+    pthread_mutex_destroy(&context->bandLock);
+    pthread_cond_destroy(&context->bandStart);
+    pthread_cond_destroy(&context->bandDone);
+}
+
+
+void InitPipeMode(void) {
+    SetTraceLogCallback(LogToStderr);
+    SetBinaryStdio();
+}
+
+
+int RunPipeMode(const PipeOptions* options) {
+    static PipeContext context;
+    memset(&context, 0, sizeof(context));
+    context.options = *options;
+    SetPalette(&context, options->lightColor, options->darkColor);
+
+    if (options->outputFormat == PIPE_FORMAT_CONTAINER && (options->codec == NULL || options->muxer == NULL)) {
+        TraceLog(LOG_ERROR, "Pipe: container output needs a codec and a muxer");
+        return 1;
+    }
+
+    if (options->inputFormat == PIPE_FORMAT_CONTAINER) {
+        context.decoder = OpenVideoDecoder("pipe:0", 0, 0, 0);
+        if (context.decoder == NULL) return 1;
+        context.width = GetVideoDecoderWidth(context.decoder);
+        context.height = GetVideoDecoderHeight(context.decoder);
+        context.frameRate = GetVideoDecoderFrameRate(context.decoder);
+        context.inputLayout = PIPE_FORMAT_YUV420P;
+    } else {
+        context.width = options->width;
+        context.height = options->height;
+        context.frameRate = 30.0;
+        context.inputLayout = options->inputFormat;
+    }
+    if (options->frameRate > 0) context.frameRate = options->frameRate;
+
+    if (context.width <= 0 || context.height <= 0) {
+        TraceLog(LOG_ERROR, "Pipe: raw input needs --size WxH");
+        CloseVideoDecoder(context.decoder);
+        return 1;
+    }
+
+    context.outputLayout = options->outputFormat;
+    if (options->outputFormat == PIPE_FORMAT_CONTAINER && !OpenEncoder(&context)) {
+        CloseEncoder(&context);
+        CloseVideoDecoder(context.decoder);
+        return 1;
+    }
+
+    // Everything is allocated up front, the frame loop only moves slot indices around
+    context.inputFrameSize = FrameSize(context.inputLayout, context.width, context.height);
+    context.outputFrameSize = FrameSize(context.outputLayout, context.width, context.height);
+    context.inputBuffer = (unsigned char*)malloc(context.inputFrameSize * PIPE_RING_SIZE);
+    if (context.encoder == NULL) context.outputBuffer = (unsigned char*)malloc(context.outputFrameSize * PIPE_RING_SIZE);
+    for (int i = 0; i < PIPE_RING_SIZE; i++) {
+        SetImagePlanes(&context.inputs[i], context.inputBuffer + i * context.inputFrameSize, context.inputLayout, context.width, context.height);
+        if (context.encoder == NULL) SetImagePlanes(&context.outputs[i], context.outputBuffer + i * context.outputFrameSize, context.outputLayout, context.width, context.height);
+    }
+
+    InitRing(&context.inputRing);
+    InitRing(&context.outputRing);
+    if (!StartWorkers(&context)) {
+        TraceLog(LOG_ERROR, "Pipe: couldn't start dither threads");
+        return 1;
+    }
+
+    pthread_t reader, writer;
+    pthread_create(&reader, NULL, ReaderMain, &context);
+    pthread_create(&writer, NULL, WriterMain, &context);
+
+    TraceLog(LOG_INFO, "Pipe: %dx%d, %d dither threads", context.width, context.height, context.workerCount);
+    double startTime = GetMonotonicTime();
+
+    for (;;) {
+        int inputSlot = BeginRingRead(&context.inputRing);
+        if (inputSlot < 0) break;
+        int outputSlot = BeginRingWrite(&context.outputRing);
+        if (outputSlot < 0) break;
+
+        if (context.encoder != NULL) PrepareOutputFrame(&context, outputSlot);
+        DitherFrame(&context, inputSlot, outputSlot);
+
+        EndRingRead(&context.inputRing);
+        EndRingWrite(&context.outputRing);
+        context.frames++;
+    }
+    CloseRing(&context.outputRing, false);
+
+    pthread_join(writer, NULL);
+    // A reader stuck in fread on a dead pipeline can't be interrupted, the process exit takes care of it
+    if (context.failed) pthread_detach(reader);
+    else pthread_join(reader, NULL);
+
+    double elapsed = GetMonotonicTime() - startTime;
+    if (elapsed > 0) {
+        TraceLog(LOG_INFO, "Pipe: %lld frames in %.2fs (%.1f fps, %.1f MB/s in)", context.frames, elapsed,
+                 context.frames / elapsed, context.frames * (double)context.inputFrameSize / elapsed / (1024*1024));
+    }
+
+    StopWorkers(&context);
+    if (!context.failed) {
+        CloseEncoder(&context);
+        CloseVideoDecoder(context.decoder);
+        DestroyRing(&context.inputRing);
+        DestroyRing(&context.outputRing);
+        free(context.inputBuffer);
+        free(context.outputBuffer);
+    }
+
+    return context.failed ? 1 : 0;
+}
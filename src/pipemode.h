@@ -0,0 +1,37 @@
+#ifndef PIPEMODE_H
+#define PIPEMODE_H
+
+#include "raylib.h"
+
+// Headless filter: frames in on stdin, dithered frames out on stdout, no window involved.
+// Meant for sitting in the middle of an ffmpeg/gstreamer pipeline.
+
+typedef enum {
+    PIPE_FORMAT_RGBA,
+    PIPE_FORMAT_RGB24,
+    PIPE_FORMAT_YUV420P,
+    PIPE_FORMAT_CONTAINER,  // In: anything FFmpeg can demux. Out: encoded with codec, muxed with muxer.
+} PipeFormat;
+
+typedef struct {
+    PipeFormat inputFormat;
+    PipeFormat outputFormat;
+    int width;             // Raw input only, containers know their own size
+    int height;
+    double frameRate;      // Used for encoded output, 0 takes it from the input (or 30 for raw input)
+    Color lightColor;
+    Color darkColor;
+    const char* codec;     // Encoder for container output, ffv1 from the command line
+    const char* muxer;     // Container for container output, nut from the command line
+    int threads;           // Dither threads, 0 picks from the core count
+} PipeOptions;
+
+bool ParsePipeFormat(const char* name, PipeFormat* format);
+
+// Moves logging to stderr and puts stdin/stdout in binary mode. Call before anything can TraceLog.
+void InitPipeMode(void);
+
+// Runs until stdin ends, returns the process exit code.
+int RunPipeMode(const PipeOptions* options);
+
+#endif
@@ -0,0 +1,239 @@
+#include "platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#include <sys/utime.h>
+#include <sys/stat.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <utime.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <sys/statvfs.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+
+int GetProcessorCount(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (info.dwNumberOfProcessors > 0) ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (int)count : 1;
+#endif
+}
+
+
+double GetMonotonicTime(void) {
+#if defined(_WIN32)
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+#endif
+}
+
+
+void SleepSeconds(double seconds) {
+#if defined(_WIN32)
+    Sleep((DWORD)(seconds * 1000.0));
+#else
+    struct timespec duration = {(time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9)};
+    nanosleep(&duration, NULL);
+#endif
+}
+
+
+void LowerThreadPriority(void) {
+#if defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__)
+    // Linux keeps a nice value per thread, setpriority on the thread id only touches this one
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10);
+#else
+    setpriority(PRIO_PROCESS, 0, 10);
+#endif
+}
+
+
+void SetBinaryStdio(void) {
+#if defined(_WIN32)
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+}
+
+
+bool MapFileSequential(const char* fileName, MappedFile* file) {
+    memset(file, 0, sizeof(*file));
+#if defined(_WIN32)
+    HANDLE handle = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    const void* data = NULL;
+    if (GetFileSizeEx(handle, &size) && size.QuadPart > 0) mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping != NULL) data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL) {
+        if (mapping != NULL) CloseHandle(mapping);
+        CloseHandle(handle);
+        return false;
+    }
+
+    file->data = (const unsigned char*)data;
+    file->size = size.QuadPart;
+    file->handle = handle;
+    file->mapping = mapping;
+#else
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) data = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    madvise(data, info.st_size, MADV_SEQUENTIAL);
+
+    file->data = (const unsigned char*)data;
+    file->size = info.st_size;
+    file->handle = (void*)(intptr_t)fd;
+#endif
+    return true;
+}
+
+
+void UnmapFile(MappedFile* file) {
+    if (file->data == NULL) return;
+#if defined(_WIN32)
+    UnmapViewOfFile(file->data);
+    CloseHandle((HANDLE)file->mapping);
+    CloseHandle((HANDLE)file->handle);
+#else
+    munmap((void*)file->data, file->size);
+    close((int)(intptr_t)file->handle);
+#endif
+    memset(file, 0, sizeof(*file));
+}
+
+
+void TouchFile(const char* fileName) {
+#if defined(_WIN32)
+    _utime(fileName, NULL);
+#else
+    utime(fileName, NULL);
+#endif
+}
+
+
+long long GetFreeDiskSpace(const char* path) {
+#if defined(_WIN32)
+    ULARGE_INTEGER available;
+    if (!GetDiskFreeSpaceExA(path, &available, NULL, NULL)) return -1;
+    return (long long)available.QuadPart;
+#else
+    struct statvfs info;
+    if (statvfs(path, &info) != 0) return -1;
+    return (long long)info.f_bavail * info.f_frsize;
+#endif
+}
+
+
+bool GetFileInfo(const char* path, bool* isDirectory, long long* size, long long* modTime) {
+#if defined(_WIN32)
+    struct _stati64 info;
+    if (_stati64(path, &info) != 0) return false;
+    *isDirectory = (info.st_mode & _S_IFDIR) != 0;
+#else
+    struct stat info;
+    if (stat(path, &info) != 0) return false;
+    *isDirectory = S_ISDIR(info.st_mode);
+#endif
+    *size = (long long)info.st_size;
+    *modTime = (long long)info.st_mtime;
+    return true;
+}
+
+
+#define DIRECTORY_WATCH_MAX_ROOTS 64  // WaitForMultipleObjects can't take more
+
+struct DirectoryWatch {
+#if defined(_WIN32)
+    HANDLE handles[DIRECTORY_WATCH_MAX_ROOTS];
+    int count;
+#else
+    int fd;
+#endif
+};
+
+
+DirectoryWatch* OpenDirectoryWatch(void) {
+    DirectoryWatch* watch = (DirectoryWatch*)calloc(1, sizeof(DirectoryWatch));
+#if !defined(_WIN32)
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    return watch;
+}
+
+
+void CloseDirectoryWatch(DirectoryWatch* watch) {
+    if (watch == NULL) return;
+#if defined(_WIN32)
+    for (int i = 0; i < watch->count; i++) FindCloseChangeNotification(watch->handles[i]);
+#else
+    if (watch->fd >= 0) close(watch->fd);
+#endif
+    free(watch);
+}
+
+
+void AddDirectoryWatch(DirectoryWatch* watch, const char* path, bool isRoot) {
+#if defined(_WIN32)
+    // One recursive notification per root covers everything below it
+    if (!isRoot || watch->count == DIRECTORY_WATCH_MAX_ROOTS) return;
+    HANDLE handle = FindFirstChangeNotificationA(path, TRUE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+    if (handle != INVALID_HANDLE_VALUE) watch->handles[watch->count++] = handle;
+#else
+    // Adding a directory that's already watched just returns its old watch, so rescans can add everything again.
+    // Past fs.inotify.max_user_watches this fails quietly and those directories only update on the next full scan.
+    if (watch->fd >= 0) inotify_add_watch(watch->fd, path, IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_DELETE_SELF);
+#endif
+}
+
+
+bool PollDirectoryWatch(DirectoryWatch* watch) {
+    bool changed = false;
+#if defined(_WIN32)
+    for (int i = 0; i < watch->count; i++) {
+        if (WaitForSingleObject(watch->handles[i], 0) == WAIT_OBJECT_0) {
+            changed = true;
+            FindNextChangeNotification(watch->handles[i]);
+        }
+    }
+#else
+    // The events themselves don't matter, only that there were some
+    char buffer[4096];
+    while (watch->fd >= 0 && read(watch->fd, buffer, sizeof(buffer)) > 0) changed = true;
+#endif
+    return changed;
+}
@@ -0,0 +1,55 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stdbool.h>
+
+// The few OS-specific bits that can't live next to raylib.h (windows.h clashes with it).
+
+int GetProcessorCount(void);
+
+// Seconds from an arbitrary point, for when there's no window (and so no GetTime).
+double GetMonotonicTime(void);
+
+// Plain sleep for background threads (raylib's WaitTime spins for part of it).
+void SleepSeconds(double seconds);
+
+// Drops the calling thread below normal priority, for work that shouldn't compete with the UI and playback.
+// On Linux threads started afterwards from this one inherit it, on Windows each thread has to ask.
+void LowerThreadPriority(void);
+
+// Stops Windows from mangling binary data going through stdin/stdout. No-op elsewhere.
+void SetBinaryStdio(void);
+
+// Read-only view of a whole file.
+typedef struct {
+    const unsigned char* data;
+    long long size;
+    void* handle;   // File handle / descriptor, OS specific
+    void* mapping;  // Windows file mapping object
+} MappedFile;
+
+// Maps fileName read-only, telling the OS it'll be read front to back (madvise / FILE_FLAG_SEQUENTIAL_SCAN).
+bool MapFileSequential(const char* fileName, MappedFile* file);
+void UnmapFile(MappedFile* file);
+
+// Bumps a file's modification time to now, for LRU bookkeeping on disk.
+void TouchFile(const char* fileName);
+
+// Bytes free for this user on the disk path is on, -1 if it can't be told.
+long long GetFreeDiskSpace(const char* path);
+
+// stat() with 64-bit sizes everywhere (MinGW's plain stat tops out at 2GB). False if path doesn't exist.
+bool GetFileInfo(const char* path, bool* isDirectory, long long* size, long long* modTime);
+
+// Tells whether anything was added, removed or renamed under a set of directories.
+// Windows watches each root recursively, elsewhere it's inotify, which needs every directory added one by one.
+typedef struct DirectoryWatch DirectoryWatch;
+
+DirectoryWatch* OpenDirectoryWatch(void);
+void CloseDirectoryWatch(DirectoryWatch* watch);
+// isRoot directories are the ones given by the user (add each once), the rest were found inside them.
+void AddDirectoryWatch(DirectoryWatch* watch, const char* path, bool isRoot);
+// True if something changed since the last poll. Never blocks.
+bool PollDirectoryWatch(DirectoryWatch* watch);
+
+#endif
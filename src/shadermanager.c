@@ -0,0 +1,401 @@
+#include "shadermanager.h"
+#include "appmem.h"
+#include "rlgl.h"
+#include <stdio.h>
+#include <string.h>
+
+// How often watched files are checked for changes, in seconds.
+#define SHADER_POLL_INTERVAL 0.5
+
+// Cached binaries bigger than this are treated as corrupt.
+#define SHADER_BINARY_MAX_SIZE (16*1024*1024)
+
+// rlgl doesn't expose program binaries, so the handful of GL entry points we need are loaded by hand.
+// We can't include windows.h next to raylib.h, hence the bare declarations.
+#if defined(_WIN32)
+#define GLAPIENTRY __stdcall
+__declspec(dllimport) void* __stdcall wglGetProcAddress(const char* name);
+__declspec(dllimport) void* __stdcall GetModuleHandleA(const char* name);
+__declspec(dllimport) void* __stdcall GetProcAddress(void* module, const char* name);
+#else
+#define GLAPIENTRY
+typedef void (*GLFWglproc)(void);
+GLFWglproc glfwGetProcAddress(const char* procname);
+#endif
+
+#define GL_VENDOR 0x1F00
+#define GL_RENDERER 0x1F01
+#define GL_VERSION 0x1F02
+#define GL_LINK_STATUS 0x8B82
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+
+typedef unsigned int (GLAPIENTRY *PFNCREATEPROGRAM)(void);
+typedef void (GLAPIENTRY *PFNPROGRAMSHADER)(unsigned int program, unsigned int shader);
+typedef void (GLAPIENTRY *PFNDELETESHADER)(unsigned int shader);
+typedef void (GLAPIENTRY *PFNBINDATTRIBLOCATION)(unsigned int program, unsigned int index, const char* name);
+typedef void (GLAPIENTRY *PFNLINKPROGRAM)(unsigned int program);
+typedef void (GLAPIENTRY *PFNGETPROGRAMIV)(unsigned int program, unsigned int pname, int* params);
+typedef void (GLAPIENTRY *PFNGETPROGRAMINFOLOG)(unsigned int program, int bufSize, int* length, char* infoLog);
+typedef void (GLAPIENTRY *PFNPROGRAMPARAMETERI)(unsigned int program, unsigned int pname, int value);
+typedef void (GLAPIENTRY *PFNGETPROGRAMBINARY)(unsigned int program, int bufSize, int* length, unsigned int* binaryFormat, void* binary);
+typedef void (GLAPIENTRY *PFNPROGRAMBINARY)(unsigned int program, unsigned int binaryFormat, const void* binary, int length);
+typedef void (GLAPIENTRY *PFNGETINTEGERV)(unsigned int pname, int* data);
+typedef const unsigned char* (GLAPIENTRY *PFNGETSTRING)(unsigned int name);
+typedef void (GLAPIENTRY *PFNFINISH)(void);
+
+static struct {
+    bool loaded;
+    bool binarySupported;
+    PFNCREATEPROGRAM createProgram;
+    PFNPROGRAMSHADER attachShader;
+    PFNPROGRAMSHADER detachShader;
+    PFNDELETESHADER deleteShader;
+    PFNBINDATTRIBLOCATION bindAttribLocation;
+    PFNLINKPROGRAM linkProgram;
+    PFNGETPROGRAMIV getProgramiv;
+    PFNGETPROGRAMINFOLOG getProgramInfoLog;
+    PFNPROGRAMPARAMETERI programParameteri;
+    PFNGETPROGRAMBINARY getProgramBinary;
+    PFNPROGRAMBINARY programBinary;
+    PFNGETINTEGERV getIntegerv;
+    PFNGETSTRING getString;
+    PFNFINISH finish;
+} gl = {0};
+
+// On-disk header of a cached program binary.
+typedef struct {
+    char magic[4];
+    unsigned int format;
+    unsigned int length;
+} ShaderBinaryHeader;
+
+static struct {
+    bool cacheEnabled;
+    char cacheDirectory[512];
+    unsigned long long driverHash;
+
+    ShaderProgram* watched[SHADER_MANAGER_MAX_WATCHED];
+    long modTimes[SHADER_MANAGER_MAX_WATCHED];
+    int fileSizes[SHADER_MANAGER_MAX_WATCHED];
+    int watchedCount;
+    double lastPoll;
+} manager = {0};
+
+// Same as raylib's default GL 3.3 vertex shader, which is what LoadShader(NULL, ...) pairs fragment shaders with.
+static const char* defaultVertexShader =
+    "#version 330\n"
+    "in vec3 vertexPosition;\n"
+    "in vec2 vertexTexCoord;\n"
+    "in vec4 vertexColor;\n"
+    "out vec2 fragTexCoord;\n"
+    "out vec4 fragColor;\n"
+    "uniform mat4 mvp;\n"
+    "void main()\n"
+    "{\n"
+    "    fragTexCoord = vertexTexCoord;\n"
+    "    fragColor = vertexColor;\n"
+    "    gl_Position = mvp*vec4(vertexPosition, 1.0);\n"
+    "}\n";
+
+
+static void* GetGLProc(const char* name) {
+#if defined(_WIN32)
+    void* proc = wglGetProcAddress(name);
+    // GL 1.1 functions only come out of opengl32.dll itself
+    if (proc == NULL) proc = GetProcAddress(GetModuleHandleA("opengl32.dll"), name);
+    return proc;
+#else
+    return (void*)glfwGetProcAddress(name);
+#endif
+}
+
+
+static void LoadGLFunctions(void) {
+    gl.createProgram = (PFNCREATEPROGRAM)GetGLProc("glCreateProgram");
+    gl.attachShader = (PFNPROGRAMSHADER)GetGLProc("glAttachShader");
+    gl.detachShader = (PFNPROGRAMSHADER)GetGLProc("glDetachShader");
+    gl.deleteShader = (PFNDELETESHADER)GetGLProc("glDeleteShader");
+    gl.bindAttribLocation = (PFNBINDATTRIBLOCATION)GetGLProc("glBindAttribLocation");
+    gl.linkProgram = (PFNLINKPROGRAM)GetGLProc("glLinkProgram");
+    gl.getProgramiv = (PFNGETPROGRAMIV)GetGLProc("glGetProgramiv");
+    gl.getProgramInfoLog = (PFNGETPROGRAMINFOLOG)GetGLProc("glGetProgramInfoLog");
+    gl.programParameteri = (PFNPROGRAMPARAMETERI)GetGLProc("glProgramParameteri");
+    gl.getProgramBinary = (PFNGETPROGRAMBINARY)GetGLProc("glGetProgramBinary");
+    gl.programBinary = (PFNPROGRAMBINARY)GetGLProc("glProgramBinary");
+    gl.getIntegerv = (PFNGETINTEGERV)GetGLProc("glGetIntegerv");
+    gl.getString = (PFNGETSTRING)GetGLProc("glGetString");
+    gl.finish = (PFNFINISH)GetGLProc("glFinish");
+
+    gl.loaded = gl.createProgram && gl.attachShader && gl.detachShader && gl.deleteShader &&
+                gl.bindAttribLocation && gl.linkProgram && gl.getProgramiv && gl.getProgramInfoLog &&
+                gl.getIntegerv && gl.getString;
+
+    // Program binaries are core in GL 4.1, older drivers may still have ARB_get_program_binary
+    if (gl.loaded && gl.programParameteri && gl.getProgramBinary && gl.programBinary) {
+        int formatCount = 0;
+        gl.getIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        gl.binarySupported = formatCount > 0;
+    }
+}
+
+
+// FNV-1a, only used to name cache files.
+static unsigned long long HashString(unsigned long long hash, const char* text) {
+    if (text == NULL) return hash;
+    for (const unsigned char* c = (const unsigned char*)text; *c; c++) {
+        hash ^= *c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+
+// Builds the raylib Shader struct around a linked program, with the same default locations LoadShader sets up.
+// locs stays on raylib's allocator, UnloadShader frees it.
+static Shader ShaderFromProgram(unsigned int id) {
+    Shader shader = {0};
+    shader.id = id;
+    shader.locs = (int*)MemAlloc(RL_MAX_SHADER_LOCATIONS * sizeof(int));
+    for (int i = 0; i < RL_MAX_SHADER_LOCATIONS; i++) shader.locs[i] = -1;
+
+    shader.locs[SHADER_LOC_VERTEX_POSITION] = rlGetLocationAttrib(id, RL_DEFAULT_SHADER_ATTRIB_NAME_POSITION);
+    shader.locs[SHADER_LOC_VERTEX_TEXCOORD01] = rlGetLocationAttrib(id, RL_DEFAULT_SHADER_ATTRIB_NAME_TEXCOORD);
+    shader.locs[SHADER_LOC_VERTEX_TEXCOORD02] = rlGetLocationAttrib(id, RL_DEFAULT_SHADER_ATTRIB_NAME_TEXCOORD2);
+    shader.locs[SHADER_LOC_VERTEX_NORMAL] = rlGetLocationAttrib(id, RL_DEFAULT_SHADER_ATTRIB_NAME_NORMAL);
+    shader.locs[SHADER_LOC_VERTEX_TANGENT] = rlGetLocationAttrib(id, RL_DEFAULT_SHADER_ATTRIB_NAME_TANGENT);
+    shader.locs[SHADER_LOC_VERTEX_COLOR] = rlGetLocationAttrib(id, RL_DEFAULT_SHADER_ATTRIB_NAME_COLOR);
+
+    shader.locs[SHADER_LOC_MATRIX_MVP] = rlGetLocationUniform(id, RL_DEFAULT_SHADER_UNIFORM_NAME_MVP);
+    shader.locs[SHADER_LOC_MATRIX_VIEW] = rlGetLocationUniform(id, RL_DEFAULT_SHADER_UNIFORM_NAME_VIEW);
+    shader.locs[SHADER_LOC_MATRIX_PROJECTION] = rlGetLocationUniform(id, RL_DEFAULT_SHADER_UNIFORM_NAME_PROJECTION);
+    shader.locs[SHADER_LOC_MATRIX_MODEL] = rlGetLocationUniform(id, RL_DEFAULT_SHADER_UNIFORM_NAME_MODEL);
+    shader.locs[SHADER_LOC_MATRIX_NORMAL] = rlGetLocationUniform(id, RL_DEFAULT_SHADER_UNIFORM_NAME_NORMAL);
+
+    shader.locs[SHADER_LOC_COLOR_DIFFUSE] = rlGetLocationUniform(id, RL_DEFAULT_SHADER_UNIFORM_NAME_COLOR);
+    shader.locs[SHADER_LOC_MAP_DIFFUSE] = rlGetLocationUniform(id, RL_DEFAULT_SHADER_SAMPLER2D_NAME_TEXTURE0);
+    shader.locs[SHADER_LOC_MAP_SPECULAR] = rlGetLocationUniform(id, RL_DEFAULT_SHADER_SAMPLER2D_NAME_TEXTURE1);
+    shader.locs[SHADER_LOC_MAP_NORMAL] = rlGetLocationUniform(id, RL_DEFAULT_SHADER_SAMPLER2D_NAME_TEXTURE2);
+
+    return shader;
+}
+
+
+static const char* GetBinaryPath(unsigned long long key) {
+    return TextFormat("%s/%016llx.bin", manager.cacheDirectory, key);
+}
+
+
+// LoadFileText, but through AppAlloc so a reload mid-playback shows up in the allocation count
+static char* LoadShaderText(const char* fileName) {
+    FILE* file = fopen(fileName, "rb");
+    if (file == NULL) {
+        TraceLog(LOG_WARNING, "Shader %s could not be opened", fileName);
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = (size >= 0) ? (char*)AppAlloc((size_t)size + 1) : NULL;
+    if (text != NULL) text[fread(text, 1, (size_t)size, file)] = '\0';
+    fclose(file);
+    return text;
+}
+
+
+static unsigned int LoadProgramBinary(unsigned long long key) {
+    FILE* file = fopen(GetBinaryPath(key), "rb");
+    if (file == NULL) return 0;
+
+    unsigned int id = 0;
+    ShaderBinaryHeader header;
+    if (fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "FFSB", 4) == 0 &&
+        header.length > 0 && header.length <= SHADER_BINARY_MAX_SIZE) {
+        void* binary = AppAlloc(header.length);
+        if (fread(binary, 1, header.length, file) == header.length) {
+            id = gl.createProgram();
+            gl.programBinary(id, header.format, binary, (int)header.length);
+
+            // Drivers are allowed to reject binaries at any time (e.g. after an update), then we just recompile
+            int linked = 0;
+            gl.getProgramiv(id, GL_LINK_STATUS, &linked);
+            if (!linked) {
+                rlUnloadShaderProgram(id);
+                id = 0;
+            }
+        }
+        AppFree(binary);
+    }
+    fclose(file);
+
+    return id;
+}
+
+
+static void SaveProgramBinary(unsigned int id, unsigned long long key) {
+    int length = 0;
+    gl.getProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0 || length > SHADER_BINARY_MAX_SIZE) return;
+
+    ShaderBinaryHeader header = {{'F', 'F', 'S', 'B'}, 0, 0};
+    void* binary = AppAlloc(length);
+    int written = 0;
+    gl.getProgramBinary(id, length, &written, &header.format, binary);
+    header.length = (unsigned int)written;
+
+    FILE* file = (written > 0) ? fopen(GetBinaryPath(key), "wb") : NULL;
+    if (file != NULL) {
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(binary, 1, written, file);
+        fclose(file);
+    }
+    AppFree(binary);
+}
+
+
+static unsigned int LinkProgram(const char* fsFileName, const char* fsCode) {
+    unsigned int vertexShader = rlCompileShader(defaultVertexShader, RL_VERTEX_SHADER);
+    unsigned int fragmentShader = rlCompileShader(fsCode, RL_FRAGMENT_SHADER);
+    if (vertexShader == 0 || fragmentShader == 0) {
+        if (vertexShader != 0) gl.deleteShader(vertexShader);
+        if (fragmentShader != 0) gl.deleteShader(fragmentShader);
+        return 0;
+    }
+
+    unsigned int id = gl.createProgram();
+    gl.attachShader(id, vertexShader);
+    gl.attachShader(id, fragmentShader);
+
+    // Same attribute slots rlgl binds, so the batch renderer can feed this program
+    gl.bindAttribLocation(id, RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION, RL_DEFAULT_SHADER_ATTRIB_NAME_POSITION);
+    gl.bindAttribLocation(id, RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD, RL_DEFAULT_SHADER_ATTRIB_NAME_TEXCOORD);
+    gl.bindAttribLocation(id, RL_DEFAULT_SHADER_ATTRIB_LOCATION_NORMAL, RL_DEFAULT_SHADER_ATTRIB_NAME_NORMAL);
+    gl.bindAttribLocation(id, RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR, RL_DEFAULT_SHADER_ATTRIB_NAME_COLOR);
+    gl.bindAttribLocation(id, RL_DEFAULT_SHADER_ATTRIB_LOCATION_TANGENT, RL_DEFAULT_SHADER_ATTRIB_NAME_TANGENT);
+    gl.bindAttribLocation(id, RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD2, RL_DEFAULT_SHADER_ATTRIB_NAME_TEXCOORD2);
+
+    if (gl.binarySupported) gl.programParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, 1);
+    gl.linkProgram(id);
+
+    gl.detachShader(id, vertexShader);
+    gl.detachShader(id, fragmentShader);
+    gl.deleteShader(vertexShader);
+    gl.deleteShader(fragmentShader);
+
+    int linked = 0;
+    gl.getProgramiv(id, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        char log[1024] = {0};
+        gl.getProgramInfoLog(id, sizeof(log), NULL, log);
+        TraceLog(LOG_WARNING, "Shader %s failed to link: %s", fsFileName, log);
+        rlUnloadShaderProgram(id);
+        return 0;
+    }
+
+    return id;
+}
+
+
+void InitShaderManager(const char* cacheDirectory) {
+    LoadGLFunctions();
+
+    if (gl.loaded) {
+        manager.driverHash = 14695981039346656037ULL;
+        manager.driverHash = HashString(manager.driverHash, (const char*)gl.getString(GL_VENDOR));
+        manager.driverHash = HashString(manager.driverHash, (const char*)gl.getString(GL_RENDERER));
+        manager.driverHash = HashString(manager.driverHash, (const char*)gl.getString(GL_VERSION));
+    }
+
+    manager.cacheEnabled = false;
+    if (cacheDirectory != NULL && gl.binarySupported) {
+        snprintf(manager.cacheDirectory, sizeof(manager.cacheDirectory), "%s", cacheDirectory);
+        if (DirectoryExists(manager.cacheDirectory) || MakeDirectory(manager.cacheDirectory) == 0) {
+            manager.cacheEnabled = true;
+        } else {
+            TraceLog(LOG_WARNING, "Shader cache directory %s not available, compiling every launch", cacheDirectory);
+        }
+    }
+
+    manager.watchedCount = 0;
+    manager.lastPoll = GetTime();
+}
+
+
+void UnloadShaderManager(void) {
+    manager.watchedCount = 0;
+}
+
+
+Shader LoadShaderCached(const char* fsFileName) {
+    Shader shader = {0};
+    char* fsCode = LoadShaderText(fsFileName);
+    if (fsCode == NULL) return shader;
+
+    if (!gl.loaded) {
+        // No way to link by hand, let raylib do it. It falls back to its default shader on errors, which we don't want.
+        shader = LoadShaderFromMemory(NULL, fsCode);
+        if (shader.id == rlGetShaderIdDefault()) shader = (Shader){0};
+        AppFree(fsCode);
+        return shader;
+    }
+
+    // The driver is part of the key, a binary from another GPU or driver version is useless
+    unsigned long long key = HashString(HashString(manager.driverHash, defaultVertexShader), fsCode);
+
+    unsigned int id = 0;
+    if (manager.cacheEnabled) id = LoadProgramBinary(key);
+    if (id != 0) {
+        TraceLog(LOG_INFO, "Shader %s loaded from program cache", fsFileName);
+    } else {
+        id = LinkProgram(fsFileName, fsCode);
+        if (id != 0 && manager.cacheEnabled) SaveProgramBinary(id, key);
+    }
+    AppFree(fsCode);
+
+    if (id != 0) shader = ShaderFromProgram(id);
+    return shader;
+}
+
+
+void WatchShaderProgram(ShaderProgram* program) {
+    if (manager.watchedCount >= SHADER_MANAGER_MAX_WATCHED) {
+        TraceLog(LOG_WARNING, "Too many watched shaders, %s won't hot reload", program->fsFileName);
+        return;
+    }
+
+    int i = manager.watchedCount++;
+    manager.watched[i] = program;
+    manager.modTimes[i] = GetFileModTime(program->fsFileName);
+    manager.fileSizes[i] = GetFileLength(program->fsFileName);
+}
+
+
+void UpdateShaderManager(void) {
+    double now = GetTime();
+    if (now - manager.lastPoll < SHADER_POLL_INTERVAL) return;
+    manager.lastPoll = now;
+
+    for (int i = 0; i < manager.watchedCount; i++) {
+        const char* fileName = manager.watched[i]->fsFileName;
+        if (!FileExists(fileName)) continue;
+
+        // Size too, mod times only have second resolution and editors like to save twice
+        long modTime = GetFileModTime(fileName);
+        int fileSize = GetFileLength(fileName);
+        if (modTime == manager.modTimes[i] && fileSize == manager.fileSizes[i]) continue;
+
+        manager.modTimes[i] = modTime;
+        manager.fileSizes[i] = fileSize;
+        if (ReloadShaderProgram(manager.watched[i])) {
+            TraceLog(LOG_INFO, "Shader %s reloaded", fileName);
+        }
+    }
+}
+
+
+void WaitForGpu(void) {
+    rlDrawRenderBatchActive();
+    if (gl.finish != NULL) gl.finish();
+}
@@ -0,0 +1,27 @@
+#ifndef SHADERMANAGER_H
+#define SHADERMANAGER_H
+
+#include "raylib.h"
+#include "shaderprogram.h"
+
+#define SHADER_MANAGER_MAX_WATCHED 8
+
+// Needs a GL context, so call it after InitWindow.
+// cacheDirectory is where linked program binaries are kept between launches (NULL disables the cache).
+void InitShaderManager(const char* cacheDirectory);
+void UnloadShaderManager(void);
+
+// Compiles a fragment shader against raylib's default vertex shader.
+// Reuses a cached program binary when the driver supports it, returns a shader with id 0 on failure.
+Shader LoadShaderCached(const char* fsFileName);
+
+// Watched programs get recompiled in place when their source changes on disk.
+// If the new source doesn't compile the program keeps running the last good version.
+void WatchShaderProgram(ShaderProgram* program);
+void UpdateShaderManager(void);
+
+// Sends raylib's pending batch and blocks until the GPU is done with everything, so a frame can be timed
+// including its fill cost. rlgl has no glFinish, it's loaded with the rest. Needs InitShaderManager.
+void WaitForGpu(void);
+
+#endif
@@ -0,0 +1,131 @@
+#include "shaderprogram.h"
+#include "shadermanager.h"
+#include <stdio.h>
+#include <string.h>
+
+static int UniformSize(int type) {
+    switch (type) {
+        case SHADER_UNIFORM_VEC2:
+        case SHADER_UNIFORM_IVEC2:
+            return 8;
+        case SHADER_UNIFORM_VEC3:
+        case SHADER_UNIFORM_IVEC3:
+            return 12;
+        case SHADER_UNIFORM_VEC4:
+        case SHADER_UNIFORM_IVEC4:
+            return 16;
+        default:
+            return 4;
+    }
+}
+
+
+// Nobody should be calling GetShaderLocation per frame, so everything is resolved here.
+static void ResolveUniformLocations(ShaderProgram* program) {
+    for (int i = 0; i < program->uniformCount; i++) {
+        program->locs[i] = -1;
+        if (program->shader.id == 0) continue;
+
+        program->locs[i] = GetShaderLocation(program->shader, program->uniforms[i].name);
+        if (program->locs[i] == -1) {
+            TraceLog(LOG_WARNING, "Shader program %s: uniform \"%s\" not found", program->fsFileName, program->uniforms[i].name);
+        }
+    }
+
+    // Whatever we think is on the GPU belonged to the old program
+    program->uploadedMask = 0;
+    program->boundBlock = NULL;
+}
+
+
+ShaderProgram LoadShaderProgram(const char* fsFileName, const ShaderUniformDesc* uniforms, int uniformCount) {
+    ShaderProgram program = {0};
+
+    if (uniformCount > SHADER_PROGRAM_MAX_UNIFORMS) {
+        TraceLog(LOG_WARNING, "Shader program %s: too many uniforms, only the first %d are used", fsFileName, SHADER_PROGRAM_MAX_UNIFORMS);
+        uniformCount = SHADER_PROGRAM_MAX_UNIFORMS;
+    }
+
+    snprintf(program.fsFileName, sizeof(program.fsFileName), "%s", fsFileName);
+    program.uniformCount = uniformCount;
+    for (int i = 0; i < uniformCount; i++) program.uniforms[i] = uniforms[i];
+
+    // fsFileName might be a TextFormat buffer, only use our own copy from here on
+    program.shader = LoadShaderCached(program.fsFileName);
+    if (program.shader.id == 0) TraceLog(LOG_WARNING, "Shader program %s failed to load", program.fsFileName);
+    ResolveUniformLocations(&program);
+
+    return program;
+}
+
+
+void UnloadShaderProgram(ShaderProgram* program) {
+    if (program->shader.id > 0) UnloadShader(program->shader);
+    program->shader = (Shader){0};
+    program->uploadedMask = 0;
+    program->boundBlock = NULL;
+}
+
+
+bool ReloadShaderProgram(ShaderProgram* program) {
+    Shader shader = LoadShaderCached(program->fsFileName);
+    if (shader.id == 0) {
+        TraceLog(LOG_WARNING, "Shader program %s failed to reload, keeping the last good version", program->fsFileName);
+        return false;
+    }
+
+    if (program->shader.id > 0) UnloadShader(program->shader);
+    program->shader = shader;
+    ResolveUniformLocations(program);
+
+    return true;
+}
+
+
+bool IsShaderProgramReady(const ShaderProgram* program) {
+    return program->shader.id > 0;
+}
+
+
+void SetUniformBlockValue(ShaderUniformBlock* block, const ShaderProgram* program, int index, const void* value) {
+    if (index < 0 || index >= program->uniformCount) return;
+
+    int size = UniformSize(program->uniforms[index].type);
+    if (memcmp(block->values[index], value, size) != 0) {
+        memcpy(block->values[index], value, size);
+        block->dirtyMask |= 1u << index;
+    }
+}
+
+
+void BeginShaderProgram(ShaderProgram* program, ShaderUniformBlock* block) {
+    if (program->shader.id > 0 && block != NULL) {
+        // If some other block was bound last we can't trust the dirty bits alone,
+        // so compare every value against what's actually on the GPU.
+        unsigned int pending = block->dirtyMask;
+        if (program->boundBlock != block) pending = (1u << program->uniformCount) - 1;
+
+        for (int i = 0; i < program->uniformCount; i++) {
+            unsigned int bit = 1u << i;
+            if (!(pending & bit) || program->locs[i] == -1) continue;
+
+            int size = UniformSize(program->uniforms[i].type);
+            if (!(program->uploadedMask & bit) || memcmp(program->uploaded[i], block->values[i], size) != 0) {
+                SetShaderValue(program->shader, program->locs[i], block->values[i], program->uniforms[i].type);
+                memcpy(program->uploaded[i], block->values[i], size);
+                program->uploadedMask |= bit;
+            }
+        }
+
+        block->dirtyMask = 0;
+        program->boundBlock = block;
+    }
+
+    // Without a program the texture is just drawn as is, better than raylib choking on a null shader
+    if (program->shader.id > 0) BeginShaderMode(program->shader);
+}
+
+
+void EndShaderProgram(void) {
+    EndShaderMode();
+}
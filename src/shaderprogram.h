@@ -0,0 +1,48 @@
+#ifndef SHADERPROGRAM_H
+#define SHADERPROGRAM_H
+
+#include "raylib.h"
+
+#define SHADER_PROGRAM_MAX_UNIFORMS 8
+
+// Describes one uniform a program expects. Type is a ShaderUniformDataType.
+typedef struct {
+    const char* name;
+    int type;
+} ShaderUniformDesc;
+
+// A set of uniform values for one "use" of a program.
+// Several blocks can share the same program (the UI and the video both use dither.fs,
+// they just bind different colors), dirtyMask tracks what changed since the last upload.
+typedef struct {
+    unsigned char values[SHADER_PROGRAM_MAX_UNIFORMS][16];
+    unsigned int dirtyMask;
+} ShaderUniformBlock;
+
+// A compiled shader with all of its uniform locations resolved once at load.
+// The program remembers what's currently on the GPU so binding a block only uploads the difference.
+typedef struct {
+    Shader shader;
+    char fsFileName[512];
+    int uniformCount;
+    ShaderUniformDesc uniforms[SHADER_PROGRAM_MAX_UNIFORMS];
+    int locs[SHADER_PROGRAM_MAX_UNIFORMS];
+
+    unsigned char uploaded[SHADER_PROGRAM_MAX_UNIFORMS][16];
+    unsigned int uploadedMask;
+    const ShaderUniformBlock* boundBlock;
+} ShaderProgram;
+
+ShaderProgram LoadShaderProgram(const char* fsFileName, const ShaderUniformDesc* uniforms, int uniformCount);
+void UnloadShaderProgram(ShaderProgram* program);
+// Recompiles from fsFileName, on failure the current shader is kept and false is returned.
+bool ReloadShaderProgram(ShaderProgram* program);
+bool IsShaderProgramReady(const ShaderProgram* program);
+
+void SetUniformBlockValue(ShaderUniformBlock* block, const ShaderProgram* program, int index, const void* value);
+
+// Uploads whatever differs between the block and the GPU, then begins shader mode.
+void BeginShaderProgram(ShaderProgram* program, ShaderUniformBlock* block);
+void EndShaderProgram(void);
+
+#endif
@@ -0,0 +1,103 @@
+#include "syncclock.h"
+#include <math.h>
+#include <string.h>
+
+static const char* policyNames[SYNC_POLICY_COUNT] = {"drop", "keyframe", "hold"};
+
+
+bool ParseSyncPolicy(const char* name, SyncPolicy* policy) {
+    for (int i = 0; i < SYNC_POLICY_COUNT; i++) {
+        if (strcmp(name, policyNames[i]) == 0) {
+            *policy = (SyncPolicy)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+const char* GetSyncPolicyName(SyncPolicy policy) {
+    return (policy >= 0 && policy < SYNC_POLICY_COUNT) ? policyNames[policy] : "?";
+}
+
+
+void ResetSyncClock(SyncClock* clock, SyncPolicy policy, double position, double frameRate) {
+    *clock = (SyncClock){0};
+    clock->policy = policy;
+    // Some containers don't know their frame rate, 30 is as good a guess as any
+    clock->frameDuration = 1.0 / ((frameRate > 0) ? frameRate : 30.0);
+    clock->masterTime = position;
+    clock->lastPosition = position;
+    clock->lastSeekTime = -SYNC_SEEK_COOLDOWN;
+}
+
+
+SyncStep UpdateSyncClock(SyncClock* clock, double frameTime, double position, bool playing) {
+    SyncStep step = {frameTime, -1.0};
+    clock->playing = playing;
+
+    // Paused, nothing to keep up with
+    if (!playing) {
+        clock->masterTime = position;
+        return step;
+    }
+
+    clock->masterTime += frameTime;
+    double behind = clock->masterTime - position;
+
+    // Ahead of the clock (or right on it), hold the current frame until the clock catches up
+    if (behind <= 0) {
+        step.step = 0;
+        return step;
+    }
+
+    switch (clock->policy) {
+        case SYNC_POLICY_KEYFRAME:
+            // Decoding the whole backlog just makes the next frame late too, jump instead.
+            // The demuxer lands on the nearest keyframe, so don't ask again until that's settled.
+            if (behind > SYNC_SEEK_THRESHOLD && clock->masterTime - clock->lastSeekTime > SYNC_SEEK_COOLDOWN) {
+                step.seekTo = clock->masterTime;
+                step.step = 0;
+                clock->lastSeekTime = clock->masterTime;
+                clock->seeks++;
+                break;
+            }
+            step.step = behind;
+            break;
+        case SYNC_POLICY_HOLD:
+            // At most one frame per update, whatever doesn't fit is time the clip falls behind
+            step.step = fmin(behind, clock->frameDuration);
+            clock->heldTime += behind - step.step;
+            clock->masterTime = position + step.step;
+            break;
+        default:
+            step.step = behind;
+            break;
+    }
+
+    return step;
+}
+
+
+void SettleSyncClock(SyncClock* clock, double position) {
+    // Went backwards, the clip looped or got seeked, either way it's the new starting point
+    if (position < clock->lastPosition - clock->frameDuration) {
+        clock->masterTime = position;
+        clock->lastPosition = position;
+        clock->drift = 0;
+        return;
+    }
+
+    if (clock->playing) {
+        // Every frame the position moved past beyond the one that's showing now was never on screen
+        // (nudged up a hair, positions that are exact frame multiples tend to come back a rounding error short)
+        int advanced = (int)floor(position / clock->frameDuration + 1e-6) - (int)floor(clock->lastPosition / clock->frameDuration + 1e-6);
+        if (advanced > 1) clock->framesDropped += advanced - 1;
+        if (advanced > 0) clock->framesShown++;
+
+        clock->drift = clock->masterTime - position;
+        if (fabs(clock->drift) > clock->maxDrift) clock->maxDrift = fabs(clock->drift);
+    }
+
+    clock->lastPosition = position;
+}
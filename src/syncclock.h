@@ -0,0 +1,56 @@
+#ifndef SYNCCLOCK_H
+#define SYNCCLOCK_H
+
+#include <stdbool.h>
+
+// Keeps the video on a master clock that runs at wall speed (the rate the sound card eats audio),
+// instead of assuming every rendered frame is exactly one refresh later than the last.
+// When decoding can't keep up, the policy decides what gives:
+//   drop:     step the media all the way to the clock, frames in between are never shown
+//   keyframe: like drop, but when too far behind seek straight to the clock instead of decoding the backlog
+//   hold:     never skip, show every frame and let the whole clip run slow
+
+// How far behind the keyframe policy has to be before it seeks, and how long it waits before seeking again.
+#define SYNC_SEEK_THRESHOLD 0.5
+#define SYNC_SEEK_COOLDOWN 1.0
+
+typedef enum {
+    SYNC_POLICY_DROP,
+    SYNC_POLICY_KEYFRAME,
+    SYNC_POLICY_HOLD,
+    SYNC_POLICY_COUNT
+} SyncPolicy;
+
+typedef struct {
+    SyncPolicy policy;
+    double frameDuration;
+    double masterTime;    // Where playback should be by now
+    double lastPosition;  // Media position after the last update
+    double lastSeekTime;
+    bool playing;
+
+    // Since the last reset
+    double drift;         // masterTime - position after the last update, positive when the video is behind
+    double maxDrift;
+    double heldTime;      // Time the hold policy has let playback fall behind the wall clock
+    int framesShown;
+    int framesDropped;
+    int seeks;
+} SyncClock;
+
+// What to do to the media this frame. Seek first when seekTo >= 0, then update by step.
+typedef struct {
+    double step;
+    double seekTo;
+} SyncStep;
+
+bool ParseSyncPolicy(const char* name, SyncPolicy* policy);
+const char* GetSyncPolicyName(SyncPolicy policy);
+
+void ResetSyncClock(SyncClock* clock, SyncPolicy policy, double position, double frameRate);
+// frameTime is the real time since the last call, position is where the media is right now.
+SyncStep UpdateSyncClock(SyncClock* clock, double frameTime, double position, bool playing);
+// Call with the media's position once it's been updated, this is where the stats come from.
+void SettleSyncClock(SyncClock* clock, double position);
+
+#endif
@@ -0,0 +1,135 @@
+#include "targetpool.h"
+
+static struct {
+    RenderTexture2D free[RENDER_TARGET_POOL_SIZE];
+    int freeCount;
+    RenderTargetPoolStats stats;
+} pool = {0};
+
+
+static int BucketSize(int size) {
+    if (size < 1) size = 1;
+    return ((size + RENDER_TARGET_BUCKET - 1) / RENDER_TARGET_BUCKET) * RENDER_TARGET_BUCKET;
+}
+
+
+// RGBA8 color plus the 32-bit depth renderbuffer raylib attaches to every render texture.
+static long long TargetBytes(RenderTexture2D target) {
+    return (long long)target.texture.width * target.texture.height * 8;
+}
+
+
+static void DestroyTarget(RenderTexture2D target) {
+    pool.stats.liveBytes -= TargetBytes(target);
+    pool.stats.releases++;
+    UnloadRenderTexture(target);
+}
+
+
+static RenderTexture2D AcquireTarget(int width, int height, bool exact) {
+    int bucketWidth = BucketSize(width);
+    int bucketHeight = BucketSize(height);
+    long long bucketArea = (long long)bucketWidth * bucketHeight;
+
+    // Smallest pooled target that fits, as long as it's not wasting more than double the memory (or any, if exact)
+    long long maxArea = (exact) ? bucketArea : bucketArea * 2;
+    int best = -1;
+    long long bestArea = 0;
+    for (int i = 0; i < pool.freeCount; i++) {
+        RenderTexture2D candidate = pool.free[i];
+        long long area = (long long)candidate.texture.width * candidate.texture.height;
+        if (candidate.texture.width >= bucketWidth && candidate.texture.height >= bucketHeight &&
+            area <= maxArea && (best == -1 || area < bestArea)) {
+            best = i;
+            bestArea = area;
+        }
+    }
+
+    if (best != -1) {
+        RenderTexture2D target = pool.free[best];
+        pool.free[best] = pool.free[--pool.freeCount];
+        pool.stats.reuses++;
+        return target;
+    }
+
+    RenderTexture2D target = LoadRenderTexture(bucketWidth, bucketHeight);
+    pool.stats.allocations++;
+    pool.stats.liveBytes += TargetBytes(target);
+    if (pool.stats.liveBytes > pool.stats.peakBytes) pool.stats.peakBytes = pool.stats.liveBytes;
+    TraceLog(LOG_DEBUG, "Render target pool: allocated %dx%d (%d allocations, %lld KB live)",
+             bucketWidth, bucketHeight, pool.stats.allocations, pool.stats.liveBytes / 1024);
+
+    return target;
+}
+
+
+RenderTexture2D AcquireRenderTarget(int width, int height) {
+    return AcquireTarget(width, height, false);
+}
+
+
+RenderTexture2D AcquireRenderTargetExact(int width, int height) {
+    return AcquireTarget(width, height, true);
+}
+
+
+void ReleaseRenderTarget(RenderTexture2D target) {
+    if (target.id == 0) return;
+
+    if (pool.freeCount == RENDER_TARGET_POOL_SIZE) {
+        // Pool is full, drop the biggest one (the newcomer included)
+        int biggest = -1;
+        long long biggestArea = (long long)target.texture.width * target.texture.height;
+        for (int i = 0; i < pool.freeCount; i++) {
+            long long area = (long long)pool.free[i].texture.width * pool.free[i].texture.height;
+            if (area > biggestArea) {
+                biggest = i;
+                biggestArea = area;
+            }
+        }
+
+        if (biggest == -1) {
+            DestroyTarget(target);
+            return;
+        }
+        DestroyTarget(pool.free[biggest]);
+        pool.free[biggest] = target;
+        return;
+    }
+
+    pool.free[pool.freeCount++] = target;
+}
+
+
+Rectangle RenderTargetSourceRect(RenderTexture2D target, int width, int height) {
+    // What's drawn at the top-left of the target ends up at the bottom of the texture in GL terms
+    return (Rectangle){0, (float)(target.texture.height - height), (float)width, (float)-height};
+}
+
+
+bool RenderTargetFits(RenderTexture2D target, int width, int height) {
+    return target.id > 0 && target.texture.width >= width && target.texture.height >= height;
+}
+
+
+bool RenderTargetOversized(RenderTexture2D target, int width, int height) {
+    return target.texture.width > BucketSize(width) || target.texture.height > BucketSize(height);
+}
+
+
+void TrimRenderTargetPool(void) {
+    for (int i = 0; i < pool.freeCount; i++) DestroyTarget(pool.free[i]);
+    pool.freeCount = 0;
+}
+
+
+void UnloadRenderTargetPool(void) {
+    TrimRenderTargetPool();
+    TraceLog(LOG_INFO, "Render target pool: %d allocations, %d reuses, %lld KB peak",
+             pool.stats.allocations, pool.stats.reuses, pool.stats.peakBytes / 1024);
+}
+
+
+RenderTargetPoolStats GetRenderTargetPoolStats(void) {
+    return pool.stats;
+}
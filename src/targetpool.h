@@ -0,0 +1,38 @@
+#ifndef TARGETPOOL_H
+#define TARGETPOOL_H
+
+#include "raylib.h"
+
+// Render targets are allocated in buckets of this many pixels per side,
+// so small size changes (like a drag-resize) keep hitting the same texture.
+#define RENDER_TARGET_BUCKET 256
+
+// How many released targets are kept around for reuse.
+#define RENDER_TARGET_POOL_SIZE 4
+
+typedef struct {
+    int allocations;      // Textures actually created on the GPU
+    int releases;         // Textures actually destroyed
+    int reuses;           // Acquires served from the pool instead of allocating
+    long long liveBytes;  // Color + depth, in use or pooled
+    long long peakBytes;
+} RenderTargetPoolStats;
+
+// Returns a target at least width x height. It's usually bigger, so draw from the top-left corner
+// and blit with RenderTargetSourceRect.
+RenderTexture2D AcquireRenderTarget(int width, int height);
+// Same, but only exactly bucket sized, for shrinking back down once a resize has settled.
+RenderTexture2D AcquireRenderTargetExact(int width, int height);
+void ReleaseRenderTarget(RenderTexture2D target);
+
+// Source rectangle for blitting the top-left width x height of a target (flipped, like raylib wants).
+Rectangle RenderTargetSourceRect(RenderTexture2D target, int width, int height);
+bool RenderTargetFits(RenderTexture2D target, int width, int height);
+bool RenderTargetOversized(RenderTexture2D target, int width, int height);
+
+// Unloads every pooled target that isn't in use.
+void TrimRenderTargetPool(void);
+void UnloadRenderTargetPool(void);
+RenderTargetPoolStats GetRenderTargetPoolStats(void);
+
+#endif
@@ -0,0 +1,172 @@
+#include "videodecoder.h"
+#include "raylib.h"
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+#include <errno.h>
+#include <stdlib.h>
+
+struct VideoDecoder {
+    AVFormatContext* format;
+    AVCodecContext* codec;
+    struct SwsContext* scaler;
+    AVPacket* packet;
+    AVFrame* frame;
+    int streamIndex;
+    int width;
+    int height;
+    double frameRate;
+    double duration;
+    bool draining;
+};
+
+
+VideoDecoder* OpenVideoDecoder(const char* url, int width, int height, int threads) {
+    AVFormatContext* format = NULL;
+    if (avformat_open_input(&format, url, NULL, NULL) < 0) {
+        TraceLog(LOG_WARNING, "Decoder: couldn't open %s", url);
+        return NULL;
+    }
+    if (avformat_find_stream_info(format, NULL) < 0) {
+        TraceLog(LOG_WARNING, "Decoder: no stream info in %s", url);
+        avformat_close_input(&format);
+        return NULL;
+    }
+
+    const AVCodec* codec = NULL;
+    int streamIndex = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (streamIndex < 0 || codec == NULL) {
+        TraceLog(LOG_WARNING, "Decoder: no video stream in %s", url);
+        avformat_close_input(&format);
+        return NULL;
+    }
+
+    AVStream* stream = format->streams[streamIndex];
+    AVCodecContext* context = avcodec_alloc_context3(codec);
+    avcodec_parameters_to_context(context, stream->codecpar);
+    context->thread_count = threads;
+    if (avcodec_open2(context, codec, NULL) < 0) {
+        TraceLog(LOG_WARNING, "Decoder: couldn't open the %s decoder for %s", codec->name, url);
+        avcodec_free_context(&context);
+        avformat_close_input(&format);
+        return NULL;
+    }
+
+    VideoDecoder* decoder = (VideoDecoder*)calloc(1, sizeof(VideoDecoder));
+    decoder->format = format;
+    decoder->codec = context;
+    decoder->packet = av_packet_alloc();
+    decoder->frame = av_frame_alloc();
+    decoder->streamIndex = streamIndex;
+    decoder->width = (width > 0) ? width : context->width;
+    decoder->height = (height > 0) ? height : context->height;
+
+    decoder->frameRate = av_q2d(stream->avg_frame_rate);
+    if (decoder->frameRate <= 0) decoder->frameRate = av_q2d(stream->r_frame_rate);
+    if (decoder->frameRate <= 0) decoder->frameRate = 30.0;
+
+    if (format->duration != AV_NOPTS_VALUE) decoder->duration = (double)format->duration / AV_TIME_BASE;
+
+    return decoder;
+}
+
+
+void CloseVideoDecoder(VideoDecoder* decoder) {
+    if (decoder == NULL) return;
+    if (decoder->scaler != NULL) sws_freeContext(decoder->scaler);
+    av_frame_free(&decoder->frame);
+    av_packet_free(&decoder->packet);
+    avcodec_free_context(&decoder->codec);
+    avformat_close_input(&decoder->format);
+    free(decoder);
+}
+
+
+void SetVideoDecoderSize(VideoDecoder* decoder, int width, int height) {
+    // The scaler context is cached, the next frame picks the new size up
+    decoder->width = width;
+    decoder->height = height;
+}
+
+
+int GetVideoDecoderWidth(const VideoDecoder* decoder) {
+    return decoder->width;
+}
+
+
+int GetVideoDecoderHeight(const VideoDecoder* decoder) {
+    return decoder->height;
+}
+
+
+double GetVideoDecoderFrameRate(const VideoDecoder* decoder) {
+    return decoder->frameRate;
+}
+
+
+double GetVideoDecoderDuration(const VideoDecoder* decoder) {
+    return decoder->duration;
+}
+
+
+bool DecodeVideoFrame(VideoDecoder* decoder, unsigned char* planes[3], const int strides[3], double* timestamp) {
+    for (;;) {
+        int result = avcodec_receive_frame(decoder->codec, decoder->frame);
+        if (result == 0) break;
+        if (result != AVERROR(EAGAIN) || decoder->draining) return false;
+
+        // Decoder wants more input
+        if (av_read_frame(decoder->format, decoder->packet) < 0) {
+            decoder->draining = true;
+            avcodec_send_packet(decoder->codec, NULL);
+            continue;
+        }
+        if (decoder->packet->stream_index == decoder->streamIndex) {
+            avcodec_send_packet(decoder->codec, decoder->packet);
+        }
+        av_packet_unref(decoder->packet);
+    }
+
+    AVFrame* frame = decoder->frame;
+    // Cached, so this only allocates when the source format or size changes
+    decoder->scaler = sws_getCachedContext(decoder->scaler, frame->width, frame->height, (enum AVPixelFormat)frame->format,
+                                           decoder->width, decoder->height, AV_PIX_FMT_YUV420P, SWS_BILINEAR, NULL, NULL, NULL);
+    if (decoder->scaler == NULL) {
+        av_frame_unref(frame);
+        return false;
+    }
+    sws_scale(decoder->scaler, (const uint8_t* const*)frame->data, frame->linesize, 0, frame->height, planes, strides);
+
+    if (timestamp != NULL) {
+        AVStream* stream = decoder->format->streams[decoder->streamIndex];
+        *timestamp = (frame->best_effort_timestamp != AV_NOPTS_VALUE) ? frame->best_effort_timestamp * av_q2d(stream->time_base) : 0.0;
+    }
+    av_frame_unref(frame);
+
+    return true;
+}
+
+
+bool ProbeVideoFile(const char* url, int* width, int* height, double* duration) {
+    AVFormatContext* format = NULL;
+    if (avformat_open_input(&format, url, NULL, NULL) < 0) return false;
+
+    // Most containers have the size in their header, only dig into the stream (which decodes a bit) when it's missing
+    int streamIndex = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (streamIndex < 0 || format->streams[streamIndex]->codecpar->width <= 0 || format->duration == AV_NOPTS_VALUE) {
+        if (avformat_find_stream_info(format, NULL) >= 0) streamIndex = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    }
+
+    bool ok = streamIndex >= 0;
+    if (ok) {
+        AVStream* stream = format->streams[streamIndex];
+        *width = stream->codecpar->width;
+        *height = stream->codecpar->height;
+        if (format->duration != AV_NOPTS_VALUE) *duration = format->duration / (double)AV_TIME_BASE;
+        else if (stream->duration != AV_NOPTS_VALUE) *duration = stream->duration * av_q2d(stream->time_base);
+        else *duration = 0;
+    }
+
+    avformat_close_input(&format);
+    return ok;
+}
@@ -0,0 +1,29 @@
+#ifndef VIDEODECODER_H
+#define VIDEODECODER_H
+
+#include <stdbool.h>
+
+// Plain FFmpeg decoding for the paths that don't play anything (pipes, exports, caches),
+// raymedia is tied to the GPU and to real time.
+typedef struct VideoDecoder VideoDecoder;
+
+// url can be a file or anything FFmpeg understands ("pipe:0" for stdin).
+// Frames are scaled to width x height, 0 keeps the source size. threads 0 lets FFmpeg pick.
+VideoDecoder* OpenVideoDecoder(const char* url, int width, int height, int threads);
+void CloseVideoDecoder(VideoDecoder* decoder);
+
+// Changes the output size for frames decoded from now on.
+void SetVideoDecoderSize(VideoDecoder* decoder, int width, int height);
+int GetVideoDecoderWidth(const VideoDecoder* decoder);
+int GetVideoDecoderHeight(const VideoDecoder* decoder);
+double GetVideoDecoderFrameRate(const VideoDecoder* decoder);
+double GetVideoDecoderDuration(const VideoDecoder* decoder);
+
+// Reads just enough of a file to know its video size and duration, without opening a decoder.
+bool ProbeVideoFile(const char* url, int* width, int* height, double* duration);
+
+// Decodes the next frame as yuv420p into the given planes. Returns false at the end of the stream or on errors.
+// timestamp (seconds) is optional.
+bool DecodeVideoFrame(VideoDecoder* decoder, unsigned char* planes[3], const int strides[3], double* timestamp);
+
+#endif